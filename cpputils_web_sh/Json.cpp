@@ -1,20 +1,51 @@
 
 #include "Json.hpp"
+#include "JsonSimd.hpp"
+#include "JsonSax.hpp"
+#include "MappedFile.hpp"
+#include "JsonWriter.hpp"
 #include <stdexcept>
 #include <charconv>
+#include <cmath>
+#include <bit>
 #include <iostream>
 #include <format>
-#include <sstream>
+#include <thread>
+#include <condition_variable>
 
 using namespace util::string;
 using namespace util::web::json;
 
 static constexpr char Spaces[] = "\t\n\r ";
 
+// otherwise vector<Node> reallocation copies nodes, making heap copies of arena nodes and owned copies of borrowed strings
+static_assert(std::is_nothrow_move_constructible_v<Node>);
+
 // not counts 'instring' characters, it means if 'delim' is inside a string, it will be no split here
 std::vector<std::string_view> utils::smartSplit(std::string_view v, char delim) {
 	// not supported characters
 	assert(delim != '"' && delim != '\\');
+	// structural delimiters - using vectorized index instead of byte-by-byte loop
+	if ((delim == ',' || delim == ':') && v.size() <= simd::MaxIndexedSize) {
+		size_t depth = 0;
+		size_t lastPos = 0;
+		std::vector<std::string_view> res;
+		for (uint32_t pos : simd::structuralIndex(v)) {
+			char ch = v[pos];
+			if (ch == '[' || ch == '{') {
+				++depth;
+			}
+			else if (ch == ']' || ch == '}') {
+				--depth;
+			}
+			else if (ch == delim && depth == 0) {
+				res.push_back(v.substr(lastPos, pos - lastPos));
+				lastPos = pos + 1;
+			}
+		}
+		res.push_back(v.substr(lastPos));
+		return res;
+	}
 	bool insideString = false;
 	size_t insideArray = 0;
 	size_t insideObj = 0;
@@ -73,14 +104,204 @@ std::vector<std::string_view> utils::smartSplit(std::string_view v, char delim)
 }
 
 std::optional<size_t> utils::getIdx(std::string_view v) {
-	size_t pos1 = v.find_last_of("[");
-	size_t pos2 = v.find_last_of("]");
-	if ((pos1 != v.npos) && (pos2 != v.npos) && ((pos1 + 1) < pos2)) {
-		auto sub = v.substr(pos1 + 1, pos2 - (pos1 + 1));
-		return std::stoull(std::string(sub.begin(), sub.end()));
+	return parseIdx(v);
+}
+
+size_t utils::skipSpaces(std::string_view v, size_t pos) {
+	// hot path - plain loop is much faster than find_first_not_of(Spaces)
+	while (pos < v.size() && (v[pos] == ' ' || v[pos] == '\n' || v[pos] == '\r' || v[pos] == '\t')) {
+		++pos;
 	}
-	else {
-		return std::nullopt;
+	return pos;
+}
+
+size_t utils::findStrEnd(std::string_view v, size_t pos) {
+	while (pos < v.size()) {
+		if (v[pos] == '"') {
+			return pos;
+		}
+		// skipping escaped character
+		pos += (v[pos] == '\\') ? 2 : 1;
+	}
+	return v.npos;
+}
+
+size_t utils::skipValue(std::string_view v, size_t pos) {
+	if (pos >= v.size()) {
+		throw std::runtime_error("JSON: unexpected end of input");
+	}
+	if (v[pos] == '"') {
+		size_t end = findStrEnd(v, pos + 1);
+		if (end == v.npos) {
+			throw std::runtime_error("invalid string node");
+		}
+		return end + 1;
+	}
+	if (v[pos] != '{' && v[pos] != '[') {
+		// scalar value
+		while (pos < v.size() && v[pos] != ',' && v[pos] != ']' && v[pos] != '}' && v[pos] != ' ' && v[pos] != '\n' && v[pos] != '\r' && v[pos] != '\t') {
+			++pos;
+		}
+		return pos;
+	}
+	size_t depth = 0;
+	while (pos < v.size()) {
+		char ch = v[pos];
+		if (ch == '"') {
+			pos = findStrEnd(v, pos + 1);
+			if (pos == v.npos) {
+				break;
+			}
+		}
+		else if (ch == '{' || ch == '[') {
+			++depth;
+		}
+		else if (ch == '}' || ch == ']') {
+			if (--depth == 0) {
+				return pos + 1;
+			}
+		}
+		++pos;
+	}
+	throw std::runtime_error("JSON: unterminated node");
+}
+
+namespace {
+
+	// exactly representable powers of 10
+	constexpr double Pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool isDigit(char ch) {
+		return ch >= '0' && ch <= '9';
+	}
+
+}
+
+// json number grammar is checked, digits are accumulated while scanning. Doubles with up to 15 significant digits and
+// small exponents (f.e. coordinates, prices) are converted exactly by one multiplication/division (Clinger's fast path),
+// the rest - by std::from_chars over already found range (libstdc++ implements it with Eisel-Lemire algorithm).
+// Values too small for double become zero, too big ones throw
+std::variant<int64_t, double> utils::parseNumber(std::string_view v, size_t& pos) {
+	const char* first = v.data() + pos;
+	const char* last = v.data() + v.size();
+	const char* p = first;
+	bool negative = p < last && *p == '-';
+	if (negative) {
+		++p;
+	}
+	uint64_t mantissa = 0;
+	// significant digits (leading zeros are not counted) - up to 19 of them fit into mantissa
+	int digits = 0;
+	// decimal exponent of mantissa
+	int exp10 = 0;
+	auto addDigit = [&](char ch) {
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (ch - '0');
+			digits += mantissa != 0;
+			return true;
+		}
+		++digits;
+		return false;
+	};
+	const char* intStart = p;
+	while (p < last && isDigit(*p)) {
+		if (!addDigit(*p)) {
+			// dropped integer digit - value is bigger
+			++exp10;
+		}
+		++p;
+	}
+	size_t intDigits = p - intStart;
+	// no digits or leading zero
+	if (intDigits == 0 || (intDigits > 1 && *intStart == '0')) {
+		throw std::runtime_error("invalid int node");
+	}
+	bool isFloat = false;
+	if (p < last && *p == '.') {
+		isFloat = true;
+		const char* fracStart = ++p;
+		while (p < last && isDigit(*p)) {
+			if (addDigit(*p)) {
+				--exp10;
+			}
+			++p;
+		}
+		if (p == fracStart) {
+			throw std::runtime_error("invalid float node");
+		}
+	}
+	if (p < last && (*p == 'e' || *p == 'E')) {
+		isFloat = true;
+		++p;
+		bool expNegative = p < last && *p == '-';
+		if (p < last && (*p == '-' || *p == '+')) {
+			++p;
+		}
+		const char* expStart = p;
+		int exp = 0;
+		while (p < last && isDigit(*p)) {
+			// big enough for any double, avoiding overflow
+			if (exp < 100000) {
+				exp = exp * 10 + (*p - '0');
+			}
+			++p;
+		}
+		if (p == expStart) {
+			throw std::runtime_error("invalid float node");
+		}
+		exp10 += expNegative ? -exp : exp;
+	}
+	pos += p - first;
+	if (!isFloat && digits <= 19) {
+		// 19 digits fit into uint64_t, checking int64_t range
+		uint64_t limit = static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + negative;
+		if (mantissa <= limit) {
+			return negative ? static_cast<int64_t>(0 - mantissa) : static_cast<int64_t>(mantissa);
+		}
+	}
+	// integers out of int64_t range become doubles
+	if (digits <= 15 && exp10 >= -22 && exp10 <= 22) {
+		double val = static_cast<double>(mantissa);
+		val = exp10 < 0 ? val / Pow10[-exp10] : val * Pow10[exp10];
+		return negative ? -val : val;
+	}
+	double val;
+	auto res = std::from_chars(first, p, val);
+	if (res.ec == std::errc::result_out_of_range && res.ptr == p) {
+		// mantissa has at most 19 digits, so only negative exponent makes value too small
+		if (exp10 < 0) {
+			return negative ? -0.0 : 0.0;
+		}
+		throw std::runtime_error("JSON: number is out of double range");
+	}
+	if (res.ec != std::errc{} || res.ptr != p) {
+		throw std::runtime_error("invalid float node");
+	}
+	return val;
+}
+
+void utils::appendInt(std::string& s, int64_t val) {
+	char buf[24];
+	auto res = std::to_chars(buf, buf + sizeof(buf), val);
+	s.append(buf, res.ptr);
+}
+
+void utils::appendFloat(std::string& s, double val) {
+	// json has no infinities and nans
+	if (!std::isfinite(val)) {
+		s.append("null");
+		return;
+	}
+	// shortest representation which is decoded back to the same value
+	char buf[32];
+	auto res = std::to_chars(buf, buf + sizeof(buf), val);
+	s.append(buf, res.ptr);
+	// so value is decoded back as float, not int
+	if (std::find_if(buf, res.ptr, [](char ch) { return ch == '.' || ch == 'e'; }) == res.ptr) {
+		s.append(".0");
 	}
 }
 
@@ -127,7 +348,7 @@ NodeType check::getType(std::string_view v) {
 	else if (v == "true" || v == "false") {
 		return NodeType::Bool;
 	}
-	else if (v.find_first_of(".") != v.npos) {
+	else if (v.find_first_of(".eE") != v.npos) {
 		return NodeType::Float;
 	}
 	else {
@@ -139,20 +360,84 @@ bool check::isValueType(NodeType t) {
 	return t == NodeType::Bool || t == NodeType::Null || t == NodeType::Int || t == NodeType::Float || t == NodeType::String;
 }
 
+Str::Str()
+{
+
+}
+
+Str::Str(const char* s, Allocator alloc)
+	: owned{ s, alloc }
+{
+
+}
+
+Str::Str(const std::string& s, Allocator alloc)
+	: owned{ s.data(), s.size(), alloc }
+{
+
+}
+
+Str::Str(std::string_view s, Allocator alloc)
+	: owned{ s.data(), s.size(), alloc }
+{
+
+}
+
+Str::Str(std::pmr::string&& s)
+	: owned{ std::move(s) }
+{
+
+}
+
+Str::Str(const Str& other)
+	: owned{ other.data(), other.size() }
+{
+
+}
+
+Str& Str::operator=(const Str& other) {
+	if (this != &other) {
+		owned.assign(other.data(), other.size());
+		ptr = nullptr;
+		len = 0;
+	}
+	return *this;
+}
+
+Str Str::borrow(std::string_view s) {
+	Str res;
+	// empty view may have no data
+	res.ptr = s.data() ? s.data() : "";
+	res.len = s.size();
+	return res;
+}
+
 ValNode::ValNode(const std::string& s)
-	: val{ s }, _type{ NodeType::String }
+	: val{ std::in_place_type<Str>, s }, _type{ NodeType::String }
 {
 
 }
 
 ValNode::ValNode(std::string&& s) 
-	: val{ std::move(s) }, _type{NodeType::String}
+	: val{ std::in_place_type<Str>, s }, _type{NodeType::String}
 {
 
 }
 
 ValNode::ValNode(const char* s) 
-	: val{ s }, _type{ NodeType::String }
+	: val{ std::in_place_type<Str>, s }, _type{ NodeType::String }
+{
+
+}
+
+ValNode::ValNode(std::string_view s, Allocator alloc)
+	: val{ std::in_place_type<Str>, s, alloc }, _type{ NodeType::String }
+{
+
+}
+
+ValNode::ValNode(Str&& s)
+	: val{ std::move(s) }, _type{ NodeType::String }
 {
 
 }
@@ -169,105 +454,513 @@ ValNode::ValNode()
 	
 }
 
+namespace {
+
+	template<typename C>
+	inline std::shared_ptr<C> makeContainer(Allocator alloc) {
+		// container gets allocator by uses-allocator construction
+		return std::allocate_shared<C>(std::pmr::polymorphic_allocator<C>(alloc.resource()));
+	}
+
+	// copy of 'cont' in 'alloc'. Elements of copy share containers of elements of 'cont'
+	template<typename C>
+	inline std::shared_ptr<C> copyContainer(const C& cont, Allocator alloc) {
+		return std::allocate_shared<C>(std::pmr::polymorphic_allocator<C>(alloc.resource()), cont);
+	}
+
+	inline bool inArena(Allocator alloc) {
+		return alloc.resource() != std::pmr::get_default_resource();
+	}
+
+}
+
 ArrNode::ArrNode()
-	: val{}, _type{ NodeType::Array }
+	: val{ makeContainer<Container>({}) }, _type{ NodeType::Array }
 {
 
 }
 
+ArrNode::ArrNode(Allocator alloc)
+	: ArrNode(alloc, false)
+{
+
+}
+
+ArrNode::ArrNode(Allocator alloc, bool borrows)
+	: val{ makeContainer<Container>(alloc) }, _type{ NodeType::Array }, borrows{ borrows || inArena(alloc) }
+{
+
+}
 
 ArrNode::ArrNode(const std::vector<Node>& v)
-	: _type{ NodeType::Array }
+	: ArrNode()
 {
-	val = v;
+	val->assign(v.begin(), v.end());
 }
 
 ArrNode::ArrNode(std::vector<Node>&& v)
-	: _type{NodeType::Object}
+	: ArrNode()
 {
-	val = std::move(v);
+	val->assign(std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()));
 }
 
-const std::vector<Node>& ArrNode::ccont() const {
-	return val;
+// deep copy of borrowing container is placed in heap
+ArrNode::ArrNode(const ArrNode& other)
+	: val{ other.borrows ? copyContainer(other.ccont(), {}) : other.val }, _type{ other._type }
+{
+
 }
 
-std::vector<Node>& ArrNode::cont() {
-	return val;
+ArrNode& ArrNode::operator=(const ArrNode& other) {
+	if (this != &other) {
+		*this = ArrNode(other);
+	}
+	return *this;
+}
+
+const ArrNode::Container& ArrNode::ccont() const {
+	static const Container empty;
+	return val ? *val : empty;
+}
+
+ArrNode::Container& ArrNode::cont() {
+	if (!val) {
+		val = makeContainer<Container>({});
+	}
+	else if (val.use_count() > 1) {
+		val = copyContainer(*val, val->get_allocator());
+	}
+	return *val;
 }
 
 bool ArrNode::isMonotype() const {
-	if (val.size() == 0) return true;
-	NodeType t0 = std::get<ValNode>(val[0]).type();
-	return std::all_of(val.cbegin(), val.cend(), [t0](const auto& v) {
+	const auto& nodes = ccont();
+	if (nodes.size() == 0) return true;
+	NodeType t0 = std::get<ValNode>(nodes[0]).type();
+	return std::all_of(nodes.cbegin(), nodes.cend(), [t0](const auto& v) {
 		return std::get<ValNode>(v).type() == t0;
 		});
 }
 
 ObjNode::ObjNode()
-	: _type{ NodeType::Object }
+	: val{ makeContainer<Container>({}) }, _type{ NodeType::Object }
 {
 
 }
 
+ObjNode::ObjNode(Allocator alloc)
+	: ObjNode(alloc, false)
+{
+
+}
+
+ObjNode::ObjNode(Allocator alloc, bool borrows)
+	: val{ makeContainer<Container>(alloc) }, _type{ NodeType::Object }, borrows{ borrows || inArena(alloc) }
+{
+
+}
+
+ObjNode::ObjNode(std::initializer_list<std::pair<std::string, Node>> items)
+	: ObjNode()
+{
+	val->reserve(items.size());
+	for (const auto& [key, node] : items) {
+		val->emplace(Str(key), node);
+	}
+}
+
 ObjNode::ObjNode(const std::unordered_map<std::string, Node>& m)
-	: _type{ NodeType::Object } 
+	: ObjNode()
 {
-	val = m;
+	val->reserve(m.size());
+	for (const auto& [key, node] : m) {
+		val->emplace(Str(key), node);
+	}
 }
 
 ObjNode::ObjNode(std::unordered_map<std::string, Node>&& m)
-	: _type{ NodeType::Object }
+	: ObjNode()
 {
-	val = std::move(m);
+	val->reserve(m.size());
+	for (auto& [key, node] : m) {
+		val->emplace(Str(key), std::move(node));
+	}
 }
 
-const std::unordered_map<std::string, Node>& ObjNode::ccont() const {
-	return val;
+ObjNode::ObjNode(const ObjNode& other)
+	: val{ other.borrows ? copyContainer(other.ccont(), {}) : other.val }, _type{ other._type }
+{
+
 }
 
-std::unordered_map<std::string, Node>& ObjNode::cont() {
-	return val;
+ObjNode& ObjNode::operator=(const ObjNode& other) {
+	if (this != &other) {
+		*this = ObjNode(other);
+	}
+	return *this;
+}
+
+const ObjNode::Container& ObjNode::ccont() const {
+	static const Container empty;
+	return val ? *val : empty;
+}
+
+ObjNode::Container& ObjNode::cont() {
+	if (!val) {
+		val = makeContainer<Container>({});
+	}
+	else if (val.use_count() > 1) {
+		val = copyContainer(*val, val->get_allocator());
+	}
+	return *val;
 }
 
 std::vector<std::string> ObjNode::keys() const {
 	std::vector<std::string> res;
-	for (const auto& [key, v] : val) {
-		res.push_back(key);
+	for (const auto& [key, v] : ccont()) {
+		res.emplace_back(key.data(), key.size());
 	}
 	return res;
 }
 
+const Node* ObjNode::find(std::string_view key) const {
+	const auto& items = ccont();
+	auto it = items.find(key);
+	return it != items.end() ? &it->second : nullptr;
+}
+
+Node* ObjNode::find(std::string_view key) {
+	auto& items = cont();
+	auto it = items.find(key);
+	return it != items.end() ? &it->second : nullptr;
+}
+
+namespace {
+	// keys interned in JsonKeyPool are equal if they are the same pointer
+	inline bool sameKey(std::string_view k1, std::string_view k2) {
+		return k1.size() == k2.size() && (k1.data() == k2.data() || k1 == k2);
+	}
+}
+
+ObjMap::ObjMap() {
+
+}
+
+ObjMap::ObjMap(Allocator alloc)
+	: items{ alloc }, index{ alloc }
+{
+
+}
+
+ObjMap::ObjMap(const ObjMap& other, Allocator alloc)
+	: items{ other.items, alloc }, index{ other.index, alloc }
+{
+
+}
+
+void ObjMap::reserve(size_t n) {
+	items.reserve(n);
+}
+
+void ObjMap::clear() {
+	items.clear();
+	index.clear();
+}
+
+ObjMap::iterator ObjMap::find(std::string_view key) {
+	size_t pos = findPos(key);
+	return pos != NoPos ? items.begin() + pos : items.end();
+}
+
+ObjMap::const_iterator ObjMap::find(std::string_view key) const {
+	size_t pos = findPos(key);
+	return pos != NoPos ? items.begin() + pos : items.end();
+}
+
+ObjMap::iterator ObjMap::find(const PrehashedKey& key) {
+	size_t pos = findPos(key);
+	return pos != NoPos ? items.begin() + pos : items.end();
+}
+
+ObjMap::const_iterator ObjMap::find(const PrehashedKey& key) const {
+	size_t pos = findPos(key);
+	return pos != NoPos ? items.begin() + pos : items.end();
+}
+
+Node& ObjMap::at(std::string_view key) {
+	return const_cast<Node&>(static_cast<const ObjMap&>(*this).at(key));
+}
+
+const Node& ObjMap::at(std::string_view key) const {
+	size_t pos = findPos(key);
+	if (pos == NoPos) {
+		throw std::out_of_range("couldn't find key");
+	}
+	return items[pos].second;
+}
+
+Node& ObjMap::operator[](std::string_view key) {
+	if (size_t pos = findPos(key); pos != NoPos) {
+		return items[pos].second;
+	}
+	return append(Str(key, items.get_allocator()), Node())->second;
+}
+
+size_t ObjMap::erase(std::string_view key) {
+	size_t pos = findPos(key);
+	if (pos == NoPos) {
+		return 0;
+	}
+	items.erase(items.begin() + pos);
+	// positions of following items are shifted
+	if (!index.empty()) {
+		rebuildIndex();
+	}
+	return 1;
+}
+
+size_t ObjMap::findPos(std::string_view key) const {
+	if (index.empty()) {
+		for (size_t i = 0; i < items.size(); ++i) {
+			if (sameKey(items[i].first.view(), key)) {
+				return i;
+			}
+		}
+		return NoPos;
+	}
+	return probe(key, utils::hashKey(key));
+}
+
+size_t ObjMap::findPos(const PrehashedKey& key) const {
+	return index.empty() ? findPos(key.key) : probe(key.key, key.hash);
+}
+
+size_t ObjMap::probe(std::string_view key, size_t hash) const {
+	size_t mask = index.size() - 1;
+	uint32_t tag = static_cast<uint32_t>(hash >> 32);
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		const Slot& slot = index[i];
+		if (slot.pos == 0) {
+			return NoPos;
+		}
+		if (slot.tag == tag && sameKey(items[slot.pos - 1].first.view(), key)) {
+			return slot.pos - 1;
+		}
+	}
+}
+
+ObjMap::iterator ObjMap::append(Str&& key, Node&& node) {
+	items.emplace_back(std::move(key), std::move(node));
+	if (items.size() * 2 > index.size()) {
+		if (items.size() > IndexThreshold) {
+			rebuildIndex();
+		}
+	}
+	else {
+		size_t hash = utils::hashKey(items.back().first.view());
+		size_t mask = index.size() - 1;
+		size_t i = hash & mask;
+		while (index[i].pos != 0) {
+			i = (i + 1) & mask;
+		}
+		index[i] = { static_cast<uint32_t>(items.size()), static_cast<uint32_t>(hash >> 32) };
+	}
+	return items.end() - 1;
+}
+
+void ObjMap::rebuildIndex() {
+	// load factor stays under 1/2
+	index.assign(std::bit_ceil(items.size() * 4), Slot{ 0, 0 });
+	size_t mask = index.size() - 1;
+	for (size_t pos = 0; pos < items.size(); ++pos) {
+		size_t hash = utils::hashKey(items[pos].first.view());
+		size_t i = hash & mask;
+		while (index[i].pos != 0) {
+			i = (i + 1) & mask;
+		}
+		index[i] = { static_cast<uint32_t>(pos + 1), static_cast<uint32_t>(hash >> 32) };
+	}
+}
+
+JsonArena::JsonArena(size_t initialSize)
+	: buffer{ std::make_unique_for_overwrite<std::byte[]>(initialSize) }, bufferSize{ initialSize }
+{
+	mono.emplace(buffer.get(), bufferSize, &upstream);
+}
+
+void JsonArena::reset() {
+	size_t overflow = upstream.allocated;
+	// returns all overflow chunks to upstream
+	mono.reset();
+	upstream.allocated = 0;
+	if (overflow) {
+		bufferSize += overflow;
+		buffer = std::make_unique_for_overwrite<std::byte[]>(bufferSize);
+	}
+	mono.emplace(buffer.get(), bufferSize, &upstream);
+}
+
+JsonArena& JsonArena::local() {
+	thread_local JsonArena arena;
+	return arena;
+}
+
+void* JsonArena::Upstream::do_allocate(size_t bytes, size_t alignment) {
+	allocated += bytes;
+	return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void JsonArena::Upstream::do_deallocate(void* p, size_t bytes, size_t alignment) {
+	std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool JsonArena::Upstream::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+	return this == &other;
+}
+
+JsonKeyPool::JsonKeyPool(size_t maxKeys, size_t maxKeySize)
+	: maxKeys{ maxKeys }, maxKeySize{ maxKeySize }
+{
+
+}
+
+std::optional<std::string_view> JsonKeyPool::intern(std::string_view key) {
+	bool found = false;
+	auto res = internImpl(key, found);
+	++(found ? hits : misses);
+	return res;
+}
+
+std::optional<std::string_view> JsonKeyPool::internImpl(std::string_view key, bool& found) {
+	{
+		std::shared_lock lock(mutex);
+		if (auto it = keys.find(key); it != keys.end()) {
+			found = true;
+			return *it;
+		}
+	}
+	found = false;
+	if (key.size() > maxKeySize) {
+		return std::nullopt;
+	}
+	std::unique_lock lock(mutex);
+	// could be added by another thread
+	if (auto it = keys.find(key); it != keys.end()) {
+		found = true;
+		return *it;
+	}
+	if (keys.size() >= maxKeys) {
+		return std::nullopt;
+	}
+	// + 1 - no zero-sized allocations
+	char* data = static_cast<char*>(storage.allocate(key.size() + 1, 1));
+	std::memcpy(data, key.data(), key.size());
+	bytes += key.size();
+	return *keys.emplace(data, key.size()).first;
+}
+
+JsonKeyPool::Stats JsonKeyPool::stats() const {
+	std::shared_lock lock(mutex);
+	return { hits.load(), misses.load(), keys.size(), bytes };
+}
+
+JsonKeyPool::Cache::Cache(std::shared_ptr<JsonKeyPool> pool)
+	: _pool{ std::move(pool) }
+{
+
+}
+
+std::optional<std::string_view> JsonKeyPool::Cache::intern(std::string_view raw) {
+	std::string_view& slot = slots[utils::hashKey(raw) & (Size - 1)];
+	if (slot == raw) {
+		++hits;
+		return slot;
+	}
+	// keys of pool are unescaped and validated
+	if (simd::findEscape(raw) != raw.npos) {
+		++misses;
+		return std::nullopt;
+	}
+	bool found = false;
+	auto res = _pool->internImpl(raw, found);
+	++(found ? hits : misses);
+	if (res) {
+		slot = *res;
+	}
+	return res;
+}
+
+void JsonKeyPool::Cache::flushStats() {
+	_pool->hits += hits;
+	_pool->misses += misses;
+	hits = 0;
+	misses = 0;
+}
+
 Json::Json(Node& r) 
-	: root{ r }
+	: root{ std::make_shared<Node>(r) }
 {
 
 }
 
 Json::Json(Node&& r)
-	: root{ std::move(r) }
+	: root{ std::make_shared<Node>(std::move(r)) }
 {
 	;
 }
 
+Json::Json(Node&& r, JsonArena& arena) {
+	std::pmr::polymorphic_allocator<Node> nodeAlloc(arena.resource());
+	// control block is in heap: document may outlive reset of arena
+	root = std::shared_ptr<Node>(nodeAlloc.new_object<Node>(std::move(r)), ArenaDeleter());
+}
+
 Json::Json() 
-	: root{std::nullopt}
+	: root{nullptr}
+{
+
+}
+
+// copy is always placed in heap
+Json::Json(const Json& other)
+	: root{ other.root ? std::make_shared<Node>(*other.root) : nullptr }
 {
 
 }
 
+Json& Json::operator=(const Json& other) {
+	if (this != &other) {
+		root = other.root ? std::make_shared<Node>(*other.root) : nullptr;
+		source = nullptr;
+		keyPool = nullptr;
+	}
+	return *this;
+}
+
+void Json::onModify() {
+	if (inArena()) {
+		// copy of containers in arena is placed in heap
+		root = std::make_shared<Node>(*root);
+	}
+}
+
 bool Json::empty() const {
-	return root == std::nullopt;
+	return root == nullptr;
+}
+
+Node& Json::get() {
+	onModify();
+	return *root;
 }
 
 // getting keys of object nodes
-std::vector<std::string> Json::keys(const std::string& key) {
+std::vector<std::string> Json::keys(const std::string& key) const {
 	const Node& node = get(key);
 	return _keysImpl(node);
 }
 
-size_t Json::arrSize(const std::string& key) {
-	Node& node = get(key);
+size_t Json::arrSize(const std::string& key) const {
+	const Node& node = get(key);
 	return _arrSizeImpl(node);
 }
 
@@ -281,7 +974,7 @@ std::vector<std::string> Json::_keysImpl(const Node& node) const {
 	return {};
 }
 
-size_t Json::_arrSizeImpl(Node& node) {
+size_t Json::_arrSizeImpl(const Node& node) const {
 	if (std::holds_alternative<ArrNode>(node)) {
 		return std::get<ArrNode>(node).size();
 	}
@@ -291,123 +984,413 @@ size_t Json::_arrSizeImpl(Node& node) {
 	return {};
 }
 
-Node& Json::get(const std::string& key) {
+const Node& Json::get(const std::string& key) const {
 	return _getImpl(split(key, "."));
 }
 
-JsonDecoder::JsonDecoder() {
+Node& Json::get(const std::string& key) {
+	return get(split(key, "."));
+}
 
+const Node& Json::get(std::span<const PathSegment> path) const {
+	if (const Node* node = _findImpl(path); node) {
+		return *node;
+	}
+	throw std::out_of_range("couldn't get node");
 }
 
-Json JsonDecoder::decode(std::string_view v) {
-	if (v.empty()) return Json();
-	return Json(decodeImpl(v));
+Node& Json::get(std::span<const PathSegment> path) {
+	if (Node* node = find(path); node) {
+		return *node;
+	}
+	throw std::out_of_range("couldn't get node");
 }
 
-Json JsonDecoder::decode(std::ifstream& is) {
-	std::stringstream ss;
-	ss << is.rdbuf();
-	return Json(decodeImpl(ss.str()));
+const Node* Json::find(const std::string& key) const {
+	return _findImpl(split(key, "."));
 }
 
-Json JsonDecoder::decode(std::ifstream&& is) {
-	std::stringstream ss;
-	ss << is.rdbuf();
-	return Json(decodeImpl(ss.str()));
+Node* Json::find(const std::string& key) {
+	return find(split(key, "."));
 }
 
-Node JsonDecoder::decodeImpl(std::string_view v) {
-	std::string_view body = strip(v);
-	NodeType type = check::getType(body);
-	switch (type) {
-	case NodeType::Object:
-		return decodeObj(body);
-	case NodeType::Array:
-		return decodeArr(body);
-	case NodeType::String:
-		return decodeStr(body);
-	case NodeType::Int:
-		return decodeInt(body);
-	case NodeType::Float:
-		return decodeFloat(body);
-	case NodeType::Bool:
-		return decodeBool(body);
-	case NodeType::Null:
-		return decodeNull(body);
-	default:
-		throw std::logic_error("JSON: invalid node type");
-	}
+const Node* Json::find(std::span<const PathSegment> path) const {
+	return _findImpl(path);
 }
 
-Node JsonDecoder::decodeBool(std::string_view v) {
-	if (v == "true") {
-		return ValNode((bool)(true));
+Node* Json::find(std::span<const PathSegment> path) {
+	// as in find(const Cont&)
+	if (inArena() && !_findImpl(path)) {
+		return nullptr;
 	}
-	else if (v == "false") {
-		return ValNode((bool)(false));
+	onModify();
+	// as in find(const Cont&)
+	Node* curNode = root.get();
+	for (const auto& seg : path) {
+		if (auto obj = std::get_if<ObjNode>(curNode); obj) {
+			auto& cont = obj->cont();
+			auto it = cont.find(PrehashedKey{ seg.key, seg.hash });
+			curNode = it != cont.end() ? &it->second : nullptr;
+		}
+		else if (auto arr = std::get_if<ArrNode>(curNode); arr && seg.idx && *seg.idx < arr->size()) {
+			curNode = &arr->cont()[*seg.idx];
+		}
+		else {
+			curNode = nullptr;
+		}
+		if (!curNode) {
+			return nullptr;
+		}
 	}
-	throw std::runtime_error("invalid bool node");
+	return curNode;
 }
 
-Node JsonDecoder::decodeNull(std::string_view v) {
-	if (v == "null") {
-		return ValNode();
+const Node* Json::_findImpl(std::span<const PathSegment> path) const {
+	const Node* curNode = root.get();
+	for (const auto& seg : path) {
+		if (auto obj = std::get_if<ObjNode>(curNode); obj) {
+			const auto& cont = obj->ccont();
+			auto it = cont.find(PrehashedKey{ seg.key, seg.hash });
+			curNode = it != cont.end() ? &it->second : nullptr;
+		}
+		else if (auto arr = std::get_if<ArrNode>(curNode); arr && seg.idx && *seg.idx < arr->ccont().size()) {
+			curNode = &arr->ccont()[*seg.idx];
+		}
+		else {
+			curNode = nullptr;
+		}
+		if (!curNode) {
+			return nullptr;
+		}
 	}
-	throw std::runtime_error("invalid null node");
+	return curNode;
 }
 
-Node JsonDecoder::decodeInt(std::string_view v) {
-	int64_t val;
-	if (std::from_chars(v.data(), v.data() + v.size(), val).ec != std::errc{}) {
-		throw std::runtime_error("invalid int node");
-	}
-	return ValNode(val);
+JsonPath::JsonPath() {
+
 }
 
-Node JsonDecoder::decodeFloat(std::string_view v) {
-	double val;
-	if (std::from_chars(v.data(), v.data() + v.size(), val).ec != std::errc{}) {
-		throw std::runtime_error("invalid float node");
+JsonPath::JsonPath(std::string_view path)
+	: path{ std::make_shared<const std::string>(path) }
+{
+	segs.reserve(utils::countSegments(path));
+	utils::forEachSegment(*this->path, [this](const PathSegment& seg) { segs.push_back(seg); });
+}
+
+JsonPath::JsonPath(const char* path)
+	: JsonPath(std::string_view(path))
+{
+
+}
+
+JsonDecoder::JsonDecoder() {
+
+}
+
+JsonDecoder::JsonDecoder(const Opts& opts)
+	: opts{ opts }
+{
+	if (opts.keys) {
+		keyCache.emplace(opts.keys);
 	}
-	return ValNode(val);
 }
 
-Node JsonDecoder::decodeStr(std::string_view v) {
-	if (!check::isStr(v)) {
-		throw std::runtime_error("invalid string node");
+Json JsonDecoder::decode(std::string_view v) {
+	if (v.empty()) return Json();
+	mem = std::pmr::get_default_resource();
+	borrowStrings = false;
+	return withKeys(Json(decodeRoot(v)));
+}
+
+Json JsonDecoder::decode(std::string_view v, JsonArena& arena) {
+	if (v.empty()) return Json();
+	mem = arena.resource();
+	borrowStrings = false;
+	return withKeys(Json(decodeRoot(v), arena));
+}
+
+Json JsonDecoder::decode(std::string_view v, std::shared_ptr<const void> source) {
+	if (v.empty()) return Json();
+	mem = std::pmr::get_default_resource();
+	borrowStrings = true;
+	Json res(decodeRoot(v));
+	res.source = std::move(source);
+	return withKeys(std::move(res));
+}
+
+Json JsonDecoder::decode(std::string_view v, std::shared_ptr<const void> source, JsonArena& arena) {
+	if (v.empty()) return Json();
+	mem = arena.resource();
+	borrowStrings = true;
+	Json res(decodeRoot(v), arena);
+	res.source = std::move(source);
+	return withKeys(std::move(res));
+}
+
+Node JsonDecoder::decodeRoot(std::string_view v) {
+	// nodes built by threads are moved into one tree, so they can't be in arena
+	if (opts.threads != 1 && v.size() >= opts.parallelMinSize && mem == std::pmr::get_default_resource()) {
+		if (auto res = decodeParallel(v); res) {
+			return std::move(*res);
+		}
+	}
+	DomBuilder builder(mem, borrowStrings, keyCache ? &keyCache.value() : nullptr);
+	SaxParser<DomBuilder>(builder, opts.structuralIndex).parse(v);
+	if (keyCache) {
+		keyCache->flushStats();
 	}
-	return ValNode(std::string(v.data() + 1, v.size() - 2));
+	return builder.release();
 }
 
-Node JsonDecoder::decodeArr(std::string_view v) {
-	auto elems = utils::smartSplit(strip(std::string_view{v.data() + 1, v.size() - 2}), ',');
-	ArrNode arr;
-	arr.cont().reserve(elems.size());
-	for (std::string_view elem : elems) {
-		arr.cont().push_back(decodeImpl(strip(elem)));
+namespace {
+
+	// part of root container decoded by one task
+	struct Part {
+		explicit Part(size_t start)
+			: start{ start }
+		{
+
+		}
+		// ',' before first member (opening bracket for the first part). Not changed after guessing - read by threads
+		size_t start = 0;
+		// ',' or closing bracket after last member
+		size_t end = 0;
+		// container of members
+		Node members;
+		std::exception_ptr error;
+		bool ready = false;
+		// covered by previous parts - not decoded
+		bool skipped = false;
+	};
+
+	// parts are about 'partSize', each begins at ',' followed by value of the same kind as 'first'
+	// ('"' for keys of objects). Some of them may be inside strings or nested values
+	std::vector<Part> guessParts(std::string_view v, size_t open, char first, size_t partSize) {
+		auto sameKind = [first](char ch) {
+			return ch == first || (check::isNumberStart(first) && check::isNumberStart(ch));
+		};
+		std::vector<Part> res;
+		res.emplace_back(open);
+		size_t pos = open + partSize;
+		while (pos < v.size()) {
+			const void* comma = std::memchr(v.data() + pos, ',', v.size() - pos);
+			if (!comma) {
+				break;
+			}
+			size_t sep = static_cast<const char*>(comma) - v.data();
+			size_t next = utils::skipSpaces(v, sep + 1);
+			if (next < v.size() && sameKind(v[next])) {
+				res.emplace_back(sep);
+				pos = sep + partSize;
+			}
+			else {
+				pos = sep + 1;
+			}
+		}
+		return res;
 	}
-	return arr;
+
 }
 
-Node JsonDecoder::decodeObj(std::string_view v) {
-	auto elems = utils::smartSplit(strip(std::string_view{v.data() + 1, v.size() - 2}), ',');
-	ObjNode obj;
-	obj.cont().reserve(elems.size());
-	for (std::string_view elem : elems) {
-		auto pair = utils::smartSplit(strip(std::string_view{ elem.data(), elem.size() }), ':');
-		if (pair.size() != 2) {
-			throw std::runtime_error("invalid object node");
+// Root container is cut at guessed member boundaries, and parts are decoded by threads at once. Guesses are checked
+// while parts are stitched in order: part is right if the previous one (decoded from right start) ends at its start.
+// Otherwise the guess was inside a string or nested value, and part is skipped if it is covered by the previous one,
+// or decoded again from the real end of the previous one
+std::optional<Node> JsonDecoder::decodeParallel(std::string_view v) {
+	size_t open = utils::skipSpaces(v, 0);
+	if (open >= v.size() || (v[open] != '[' && v[open] != '{')) {
+		return std::nullopt;
+	}
+	bool object = v[open] == '{';
+	size_t first = utils::skipSpaces(v, open + 1);
+	if (first >= v.size() || v[first] == (object ? '}' : ']')) {
+		return std::nullopt;
+	}
+	size_t threads = opts.threads ? opts.threads : std::thread::hardware_concurrency();
+	if (threads <= 1) {
+		return std::nullopt;
+	}
+	// a few parts per thread even out their speed
+	std::vector<Part> parts = guessParts(v, open, v[first], std::max<size_t>(v.size() / (threads * 4), 64 * 1024));
+	if (parts.size() == 1) {
+		return std::nullopt;
+	}
+	threads = std::min(threads, parts.size());
+
+	auto decodePart = [&](Part& part, size_t stop, JsonKeyPool::Cache* keys) {
+		DomBuilder builder(mem, borrowStrings, keys);
+		object ? builder.onStartObject() : builder.onStartArray();
+		part.end = SaxParser<DomBuilder>(builder, opts.structuralIndex).parseMembers(v, part.start + 1, stop, object);
+		object ? builder.onEndObject() : builder.onEndArray();
+		part.members = builder.release();
+	};
+	auto stopOf = [&parts](size_t i) {
+		return i + 1 < parts.size() ? parts[i + 1].start : std::string_view::npos;
+	};
+	// guessed boundary is inside member decoded already (before 'end') - the next part continues from 'end'
+	auto covered = [&](size_t i, size_t end) {
+		return parts[i].start < end && (i + 1 < parts.size() || v[end] != ',');
+	};
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	size_t next = 0;
+	bool stop = false;
+	std::vector<std::jthread> workers;
+	auto stopWorkers = [&]() {
+		{
+			std::lock_guard lock(mutex);
+			stop = true;
 		}
-		if (pair[0].front() != '"' || pair[0].back() != '"') {
-			throw std::runtime_error("invalid object node");
+		// joins
+		workers.clear();
+	};
+	for (size_t i = 0; i < threads; ++i) {
+		workers.emplace_back([&]() {
+			std::optional<JsonKeyPool::Cache> keys;
+			if (opts.keys) {
+				keys.emplace(opts.keys);
+			}
+			std::unique_lock lock(mutex);
+			while (!stop && next < parts.size()) {
+				size_t i = next++;
+				if (parts[i].skipped) {
+					continue;
+				}
+				size_t partStop = stopOf(i);
+				lock.unlock();
+				try {
+					decodePart(parts[i], partStop, keys ? &keys.value() : nullptr);
+				}
+				catch (...) {
+					parts[i].error = std::current_exception();
+				}
+				lock.lock();
+				parts[i].ready = true;
+				cv.notify_all();
+			}
+			lock.unlock();
+			if (keys) {
+				keys->flushStats();
+			}
+		});
+	}
+
+	bool borrows = borrowStrings || opts.keys;
+	Node res = object ? Node(ObjNode(mem, borrows)) : Node(ArrNode(mem, borrows));
+	try {
+		// end of the last right part
+		size_t end = open;
+		// part decoded again from real boundary
+		std::optional<Part> redo;
+		for (size_t i = 0; i < parts.size(); ++i) {
+			if (covered(i, end)) {
+				continue;
+			}
+			Part* part = &parts[i];
+			{
+				std::unique_lock lock(mutex);
+				cv.wait(lock, [&]() { return part->ready; });
+			}
+			if (part->start != end) {
+				if (v[end] != ',') {
+					throw std::runtime_error("JSON: unexpected characters after root node");
+				}
+				part = &redo.emplace(end);
+				decodePart(*part, stopOf(i), keyCache ? &keyCache.value() : nullptr);
+			}
+			else if (part->error) {
+				// part starts at real boundary - error is in json
+				std::rethrow_exception(part->error);
+			}
+			end = part->end;
+			{
+				// workers don't decode parts which will be skipped
+				std::lock_guard lock(mutex);
+				for (size_t j = i + 1; j < parts.size() && covered(j, end); ++j) {
+					parts[j].skipped = true;
+				}
+			}
+			if (object) {
+				auto& dst = std::get<ObjNode>(res).cont();
+				for (auto& [key, node] : std::get<ObjNode>(part->members).cont()) {
+					dst.insert_or_assign(std::move(key), std::move(node));
+				}
+			}
+			else {
+				auto& src = std::get<ArrNode>(part->members).cont();
+				auto& dst = std::get<ArrNode>(res).cont();
+				dst.insert(dst.end(), std::make_move_iterator(src.begin()), std::make_move_iterator(src.end()));
+			}
+			part->members = Node();
 		}
-		if (!check::isStr(pair[0])) {
-			throw std::runtime_error("invalid object node");
+		if (utils::skipSpaces(v, end + 1) != v.size()) {
+			throw std::runtime_error("JSON: unexpected characters after root node");
 		}
-		Node valNode = decodeImpl(strip(pair[1]));
-		obj.cont()[std::string(pair[0].data() + 1, pair[0].size() - 2)] = valNode;
 	}
-	return obj;
+	catch (...) {
+		stopWorkers();
+		throw;
+	}
+	stopWorkers();
+	if (keyCache) {
+		keyCache->flushStats();
+	}
+	return res;
+}
+
+Json JsonDecoder::withKeys(Json&& res) {
+	res.keyPool = opts.keys;
+	return std::move(res);
+}
+
+Json JsonDecoder::decode(std::ifstream& is) {
+	// reading rest of file right into string - no intermediate stream buffer and copy of it
+	auto start = is.tellg();
+	is.seekg(0, std::ios::end);
+	auto end = is.tellg();
+	if (start < 0 || end <= start) {
+		return Json();
+	}
+	is.seekg(start);
+	std::string s(static_cast<size_t>(end - start), '\0');
+	is.read(s.data(), s.size());
+	s.resize(static_cast<size_t>(is.gcount()));
+	return decode(s);
+}
+
+Json JsonDecoder::decode(std::ifstream&& is) {
+	return decode(is);
+}
+
+Json JsonDecoder::decodeFile(const std::string& path, bool borrowStrings) {
+	auto file = std::make_shared<MappedFile>(path);
+	if (borrowStrings) {
+		return decode(file->view(), file);
+	}
+	return decode(file->view());
+}
+
+DomBuilder::DomBuilder(std::pmr::memory_resource* mem, bool borrowStrings, JsonKeyPool::Cache* keys)
+	: mem{ mem }, borrowStrings{ borrowStrings }, keys{ keys }, borrows{ borrowStrings || keys }
+{
+
+}
+
+Node DomBuilder::release() {
+	if (!_done) {
+		throw std::runtime_error("JSON: document is incomplete");
+	}
+	Node res = std::move(root);
+	reset();
+	return res;
+}
+
+void DomBuilder::reset() {
+	stack.clear();
+	key.reset();
+	root = Node();
+	_done = false;
 }
 
 JsonEncoder::JsonEncoder() {
@@ -421,14 +1404,143 @@ JsonEncoder::JsonEncoder(const Opts& opts)
 }
 
 std::string JsonEncoder::encode(const Json& json) {
+	std::string res;
+	res.reserve(lastSize);
+	encode(json, res);
+	lastSize = res.size();
+	return res;
+}
+
+void JsonEncoder::encode(const Json& json, JsonWriter& out) {
+	std::string buf;
+	buf.reserve(opts.chunkSize);
+	writer = &out;
+	try {
+		encode(json, buf);
+	}
+	catch (...) {
+		writer = nullptr;
+		throw;
+	}
+	writer = nullptr;
+	if (!buf.empty()) {
+		out.write(buf);
+	}
+}
+
+void JsonEncoder::flush(std::string& s) {
+	writer->write(s);
+	s.clear();
+	// writer could have taken buffer's memory
+	s.reserve(opts.chunkSize);
+}
+
+void JsonEncoder::encode(const Json& json, std::string& out) {
 	ctx.reset();
 	if (json.empty()) {
-		return "";
+		return;
 	}
-	std::string res;
-	const Node& node = json.root.value();
-	encodeImpl(res, node);
-	return res;
+	const Node& node = *json.root;
+	encodeImpl(out, node);
+}
+
+// Elements are cut into ranges, which are encoded by threads into own buffers. Buffers are delivered in order;
+// threads don't run too far ahead of delivery, so output passed to writer isn't held in memory at once
+void JsonEncoder::encodeElementsParallel(std::string& s, const ArrNode::Container& nodes) {
+	size_t threads = opts.threads ? opts.threads : std::thread::hardware_concurrency();
+	if (threads <= 1) {
+		if (opts.humanReadable) encodeElements<true>(s, nodes, 0, nodes.size());
+		else encodeElements<false>(s, nodes, 0, nodes.size());
+		return;
+	}
+	struct Part {
+		std::string out;
+		std::exception_ptr error;
+		bool ready = false;
+	};
+	// a few parts per thread even out their speed
+	size_t partSize = (nodes.size() + threads * 4 - 1) / (threads * 4);
+	std::vector<Part> parts((nodes.size() + partSize - 1) / partSize);
+	const size_t window = threads * 2;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	size_t next = 0;
+	size_t delivered = 0;
+	bool stop = false;
+	std::vector<std::jthread> workers;
+	auto stopWorkers = [&]() {
+		{
+			std::lock_guard lock(mutex);
+			stop = true;
+		}
+		cv.notify_all();
+		// joins
+		workers.clear();
+	};
+	for (size_t i = 0; i < threads; ++i) {
+		workers.emplace_back([&]() {
+			Opts partOpts = opts;
+			partOpts.threads = 1;
+			JsonEncoder encoder(partOpts);
+			encoder.ctx.intendationLvl = ctx.intendationLvl;
+			std::unique_lock lock(mutex);
+			for (;;) {
+				cv.wait(lock, [&]() { return stop || next >= parts.size() || next < delivered + window; });
+				if (stop || next >= parts.size()) {
+					return;
+				}
+				size_t i = next++;
+				lock.unlock();
+				Part& part = parts[i];
+				size_t from = i * partSize;
+				size_t to = std::min(nodes.size(), from + partSize);
+				try {
+					if (opts.humanReadable) encoder.encodeElements<true>(part.out, nodes, from, to);
+					else encoder.encodeElements<false>(part.out, nodes, from, to);
+				}
+				catch (...) {
+					part.error = std::current_exception();
+				}
+				lock.lock();
+				part.ready = true;
+				cv.notify_all();
+			}
+		});
+	}
+
+	try {
+		for (auto& part : parts) {
+			{
+				std::unique_lock lock(mutex);
+				cv.wait(lock, [&]() { return part.ready; });
+			}
+			if (part.error) {
+				std::rethrow_exception(part.error);
+			}
+			if (writer) {
+				// without copying part into 's'
+				std::array<std::string, 2> chunks{ std::move(s), std::move(part.out) };
+				writer->writeChunks(chunks);
+				s.clear();
+				s.reserve(opts.chunkSize);
+			}
+			else {
+				s.append(part.out);
+			}
+			part.out = std::string();
+			{
+				std::lock_guard lock(mutex);
+				++delivered;
+			}
+			cv.notify_all();
+		}
+	}
+	catch (...) {
+		stopWorkers();
+		throw;
+	}
+	stopWorkers();
 }
 
 void JsonEncoder::EncodingCtx::reset() {
@@ -452,7 +1564,7 @@ void JsonEncoder::encodeImpl(std::string& res, const Node& node) {
 			encodeFloat(res, vnode);
 			break;
 		case NodeType::String:
-			encodeStr(res, vnode);
+			encodeStr(res, vnode.as<std::string_view>());
 			break;
 		default:
 			break;
@@ -481,15 +1593,17 @@ void JsonEncoder::encodeBool(std::string& s, const ValNode& node) {
 }
 
 void JsonEncoder::encodeInt(std::string& s, const ValNode& node) {
-	s.append(std::to_string(node.as<int64_t>()));
+	utils::appendInt(s, node.as<int64_t>());
 }
 
 void JsonEncoder::encodeFloat(std::string& s, const ValNode& node) {
-	s.append(std::to_string(node.as<double>()));
+	utils::appendFloat(s, node.as<double>());
 }
 
-void JsonEncoder::encodeStr(std::string& s, const ValNode& node) {
-	s.append("\"").append(node.as<std::string>()).append("\"");
+void JsonEncoder::encodeStr(std::string& s, std::string_view v) {
+	s.push_back('"');
+	simd::escapeStr(v, s);
+	s.push_back('"');
 }
 
 void JsonEncoder::appendIntendation(std::string& s) {
@@ -499,9 +1613,11 @@ void JsonEncoder::appendIntendation(std::string& s) {
 }
 
 void JsonEncoder::dump(const Json& json, std::ostream& os) {
-	os << encode(json) << std::endl;
+	OstreamJsonWriter writer(os);
+	encode(json, writer);
+	os << '\n';
 }
 
 void JsonEncoder::dump(const Json& json, std::ostream&& os) {
-	os << encode(json) << std::endl;
+	dump(json, os);
 }
\ No newline at end of file
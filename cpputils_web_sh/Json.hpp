@@ -3,6 +3,8 @@
 #include <string_view>
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <memory_resource>
 #include <variant>
 #include <any>
 #include <optional>
@@ -13,6 +15,15 @@
 #include <fstream>
 #include <cstdint>
 #include <functional>
+#include <span>
+#include <unordered_set>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <initializer_list>
+#include <array>
+#include <cstring>
 #include "Utils_String.hpp"
 #include "Utils_Traits.hpp"
 
@@ -26,11 +37,53 @@ namespace util::web::json {
 	namespace utils {
 		std::vector<std::string_view> smartSplit(std::string_view v, char delim);
 		std::optional<size_t> getIdx(std::string_view v);
+		// hash of object keys. Computable at compile time, so hashes of compiled paths can be known in advance
+		constexpr size_t hashKey(std::string_view v);
+		// returns position of first non-space character starting from 'pos' (or v.size())
+		size_t skipSpaces(std::string_view v, size_t pos);
+		// 'pos' should point right after opening quote; returns position of closing quote or npos
+		size_t findStrEnd(std::string_view v, size_t pos);
+		// 'pos' should point to the first character of value; returns position right after value.
+		// Only brackets and quotes are matched, so contents of skipped value are not validated
+		size_t skipValue(std::string_view v, size_t pos);
+		// 'pos' should point to the first character of number; moves it right after number
+		std::variant<int64_t, double> parseNumber(std::string_view v, size_t& pos);
+		// number formatting of JsonEncoder: shortest round-trip doubles (integral ones get ".0"), nan and inf become null
+		void appendInt(std::string& s, int64_t val);
+		void appendFloat(std::string& s, double val);
+	}
+
+	constexpr size_t utils::hashKey(std::string_view v) {
+		// 8 bytes at a time, mixed by multiplication
+		auto load = [v](size_t pos, size_t n) {
+			uint64_t res = 0;
+			if (std::is_constant_evaluated()) {
+				for (size_t i = 0; i < n; ++i) {
+					res |= uint64_t(static_cast<unsigned char>(v[pos + i])) << (8 * i);
+				}
+			}
+			else {
+				std::memcpy(&res, v.data() + pos, n);
+			}
+			return res;
+		};
+		uint64_t h = 0x9E3779B97F4A7C15ULL ^ v.size();
+		size_t pos = 0;
+		for (; pos + 8 <= v.size(); pos += 8) {
+			h = (h ^ load(pos, 8)) * 0xff51afd7ed558ccdULL;
+			h ^= h >> 32;
+		}
+		h = (h ^ load(pos, v.size() - pos)) * 0xc4ceb9fe1a85ec53ULL;
+		return static_cast<size_t>(h ^ (h >> 29));
 	}
 
 	template <typename Cont>
 	concept StringVector = std::same_as<Cont, std::vector<std::string>> || std::same_as<Cont, std::vector<std::string_view>>;
 
+	// string types that can be read from string value nodes
+	template <typename T>
+	concept ValueStringType = std::same_as<T, std::string> || std::same_as<T, std::string_view>;
+
 	template <typename T>
 	concept ElemToObjNodeConvertable = requires(T val) {
 		std::declval<typename T::value_type>().toObjNode();
@@ -39,6 +92,7 @@ namespace util::web::json {
 	class ValNode;
 	class ArrNode;
 	class ObjNode;
+	class JsonWriter;
 
 	enum class NodeType {
 		Int,
@@ -52,6 +106,8 @@ namespace util::web::json {
 	};
 
 	using Node = std::variant<ValNode, ArrNode, ObjNode>;
+	// allocator of all node containers and strings; default one allocates from heap, decoder can use JsonArena instead
+	using Allocator = std::pmr::polymorphic_allocator<>;
 
 	namespace check {
 		//bool isObj(std::string_view v);
@@ -66,12 +122,68 @@ namespace util::web::json {
 		bool isValueType(NodeType t);
 	}
 
+	// string value or object key. Either owns its characters, or borrows them from source buffer of decoded document
+	// (see JsonDecoder::decode() with 'source'). Copy of borrowed string owns its characters, so only moved nodes stay borrowed.
+	class Str {
+	public:
+		Str();
+		Str(const char* s, Allocator alloc = {});
+		Str(const std::string& s, Allocator alloc = {});
+		explicit Str(std::string_view s, Allocator alloc = {});
+		explicit Str(std::pmr::string&& s);
+		Str(const Str& other);
+		Str(Str&& other) noexcept = default;
+		Str& operator=(const Str& other);
+		Str& operator=(Str&& other) = default;
+		// no copy - result references memory of 's'
+		static Str borrow(std::string_view s);
+		inline std::string_view view() const { return ptr ? std::string_view(ptr, len) : std::string_view(owned); }
+		inline operator std::string_view() const { return view(); }
+		inline const char* data() const { return view().data(); }
+		inline size_t size() const { return view().size(); }
+		inline bool borrowed() const { return ptr != nullptr; }
+		inline friend bool operator==(const Str& s1, const Str& s2) { return s1.view() == s2.view(); }
+	private:
+		std::pmr::string owned;
+		// borrowed characters
+		const char* ptr = nullptr;
+		size_t len = 0;
+	};
+
+	// key with hash computed in advance (see JsonPath)
+	struct PrehashedKey {
+		std::string_view key;
+		size_t hash;
+	};
+
+	// transparent - object nodes are searched by string_view, const char*, std::string and prehashed keys without making Str
+	struct StrHash {
+		using is_transparent = void;
+		inline size_t operator()(const Str& s) const { return utils::hashKey(s.view()); }
+		inline size_t operator()(std::string_view s) const { return utils::hashKey(s); }
+		inline size_t operator()(const std::string& s) const { return utils::hashKey(s); }
+		inline size_t operator()(const char* s) const { return utils::hashKey(s); }
+		inline size_t operator()(const PrehashedKey& k) const { return k.hash; }
+	};
+
+	struct StrEqual {
+		using is_transparent = void;
+		template<typename K1, typename K2>
+		inline bool operator()(const K1& k1, const K2& k2) const { return keyView(k1) == keyView(k2); }
+	private:
+		static inline std::string_view keyView(const Str& s) { return s.view(); }
+		static inline std::string_view keyView(std::string_view s) { return s; }
+		static inline std::string_view keyView(const std::string& s) { return s; }
+		static inline std::string_view keyView(const char* s) { return s; }
+		static inline std::string_view keyView(const PrehashedKey& k) { return k.key; }
+	};
+
 	class ValNode {
 	public:
 		using Val = std::variant<
 			int64_t,
 			double,
-			std::string,
+			Str,
 			bool,
 			Null
 		>;
@@ -87,12 +199,20 @@ namespace util::web::json {
 		ValNode(std::string&& s);
 		// defined, because bool constructor is called instead with this argument type
 		ValNode(const char* s);
+		ValNode(std::string_view s, Allocator alloc);
+		ValNode(Str&& s);
 		ValNode(bool b);
 		ValNode();
 		template<typename T>
-			requires util::traits::IsOneOfVariants<T, Val>::value
+			requires util::traits::IsOneOfVariants<T, Val>::value || ValueStringType<T>
 		inline T as() const {
-			return std::get<T>(val);
+			if constexpr (ValueStringType<T>) {
+				const Str& s = std::get<Str>(val);
+				return T(s.data(), s.size());
+			}
+			else {
+				return std::get<T>(val);
+			}
 		}
 		inline NodeType type() const { return _type; }
 	private:
@@ -116,23 +236,42 @@ namespace util::web::json {
 
 	}
 
+	// containers of array and object nodes are shared by copies of node (copy-on-write): copying node is O(1),
+	// and cont() copies container if it is shared, so modification of one copy doesn't change others.
+	// Only modified level is copied - elements of the copy share their own containers.
+	// Containers borrowing memory (arena, parsed text, key pool) aren't shared: their copies are deep, as before.
+	// Reference got from cont() shouldn't be used for modification after node is copied
 	class ArrNode {
 	public:
+		using Container = std::pmr::vector<Node>;
 		ArrNode();
+		// container in arena (not default memory resource) borrows it
+		explicit ArrNode(Allocator alloc);
+		// 'borrows' - elements borrow memory they don't own (strings of parsed text, interned keys)
+		ArrNode(Allocator alloc, bool borrows);
 		ArrNode(const std::vector<Node>& v);
 		ArrNode(std::vector<Node>&& v);
-		const std::vector<Node>& ccont() const;
-		std::vector<Node>& cont();
+		ArrNode(const ArrNode& other);
+		ArrNode(ArrNode&& other) noexcept = default;
+		ArrNode& operator=(const ArrNode& other);
+		ArrNode& operator=(ArrNode&& other) noexcept = default;
+		const Container& ccont() const;
+		// copies container if it is shared
+		Container& cont();
 		template<typename T>
 		std::vector<T> as() const;
-		inline size_t size() const { return val.size(); }
+		inline size_t size() const { return val ? val->size() : 0; }
 		inline NodeType type() const { return _type; }
+		// container is shared with copies of node
+		inline bool shared() const { return val.use_count() > 1; }
 		template<typename T> requires ElemToObjNodeConvertable<T>
 		static ArrNode makeFrom(const T& cont);
 	private:
 		bool isMonotype() const;
-		std::vector<Node> val;
+		// null only in moved-from node
+		std::shared_ptr<Container> val;
 		NodeType _type;
+		bool borrows = false;
 	};
 
 	template<typename T> requires ElemToObjNodeConvertable<T>
@@ -144,141 +283,538 @@ namespace util::web::json {
 		return ArrNode(std::move(nodes));
 	}
 
+	// container of object node: items are kept in insertion order (and encoded in it) in a flat vector.
+	// Small objects are searched by linear scan, hash index is built when object grows over IndexThreshold keys.
+	// Keys must not be changed through iterators
+	class ObjMap {
+	public:
+		using key_type = Str;
+		using mapped_type = Node;
+		using value_type = std::pair<Str, Node>;
+		using Items = std::pmr::vector<value_type>;
+		using iterator = Items::iterator;
+		using const_iterator = Items::const_iterator;
+		using allocator_type = Allocator;
+		static constexpr size_t IndexThreshold = 16;
+
+		ObjMap();
+		explicit ObjMap(Allocator alloc);
+		ObjMap(const ObjMap& other, Allocator alloc);
+		inline iterator begin();
+		inline iterator end();
+		inline const_iterator begin() const;
+		inline const_iterator end() const;
+		inline size_t size() const;
+		inline bool empty() const;
+		inline Allocator get_allocator() const { return items.get_allocator(); }
+		void reserve(size_t n);
+		void clear();
+		// keys are std::string_view, Str, std::string, const char* or PrehashedKey
+		iterator find(std::string_view key);
+		const_iterator find(std::string_view key) const;
+		iterator find(const PrehashedKey& key);
+		const_iterator find(const PrehashedKey& key) const;
+		inline bool contains(std::string_view key) const { return findPos(key) != NoPos; }
+		// throws std::out_of_range
+		Node& at(std::string_view key);
+		const Node& at(std::string_view key) const;
+		Node& operator[](std::string_view key);
+		template<typename M>
+		std::pair<iterator, bool> insert_or_assign(Str key, M&& node);
+		template<typename... Args>
+		std::pair<iterator, bool> emplace(Str key, Args&&... args);
+		// keeps order of other items
+		size_t erase(std::string_view key);
+	private:
+		static constexpr size_t NoPos = ~size_t(0);
+		// position of item + 1 (0 - empty slot) and upper half of key hash
+		struct Slot {
+			uint32_t pos;
+			uint32_t tag;
+		};
+		size_t findPos(std::string_view key) const;
+		size_t findPos(const PrehashedKey& key) const;
+		size_t probe(std::string_view key, size_t hash) const;
+		// appends item with absent key
+		iterator append(Str&& key, Node&& node);
+		void rebuildIndex();
+		Items items;
+		// open addressing, empty while there are few items
+		std::pmr::vector<Slot> index;
+	};
+
 	class ObjNode {
 	public:
+		using Container = ObjMap;
 		ObjNode();
+		// as in ArrNode
+		explicit ObjNode(Allocator alloc);
+		ObjNode(Allocator alloc, bool borrows);
+		// keeps order of 'items'
+		ObjNode(std::initializer_list<std::pair<std::string, Node>> items);
 		ObjNode(const std::unordered_map<std::string, Node>& m);
 		ObjNode(std::unordered_map<std::string, Node>&& m);
-		const std::unordered_map<std::string, Node>& ccont() const;
-		std::unordered_map<std::string, Node>& cont();
+		ObjNode(const ObjNode& other);
+		ObjNode(ObjNode&& other) noexcept = default;
+		ObjNode& operator=(const ObjNode& other);
+		ObjNode& operator=(ObjNode&& other) noexcept = default;
+		const Container& ccont() const;
+		// copies container if it is shared
+		Container& cont();
 		std::vector<std::string> keys() const;
+		// nullptr if there is no such key
+		const Node* find(std::string_view key) const;
+		Node* find(std::string_view key);
 		inline NodeType type() const { return _type; }
+		inline bool shared() const { return val.use_count() > 1; }
 		template<typename T, typename F>
 		static ObjNode makeFrom(const T& cont, F extractor);
 
 	private:
-		std::unordered_map<std::string, Node> val;
+		// null only in moved-from node
+		std::shared_ptr<Container> val;
 		NodeType _type;
+		bool borrows = false;
 	};
 
 	template<typename T, typename F>
 	ObjNode ObjNode::makeFrom(const T& cont, F extractor) {
-		std::unordered_map<std::string, Node> nodes;
+		ObjNode res;
 		for (const auto& elem : cont) {
-			nodes.insert(extractor(elem));
+			auto item = extractor(elem);
+			res.cont().emplace(Str(item.first), std::move(item.second));
 		}
-		return nodes;
+		return res;
 	}
 
+	ObjMap::iterator ObjMap::begin() {
+		return items.begin();
+	}
+
+	ObjMap::iterator ObjMap::end() {
+		return items.end();
+	}
+
+	ObjMap::const_iterator ObjMap::begin() const {
+		return items.begin();
+	}
+
+	ObjMap::const_iterator ObjMap::end() const {
+		return items.end();
+	}
+
+	size_t ObjMap::size() const {
+		return items.size();
+	}
+
+	bool ObjMap::empty() const {
+		return items.empty();
+	}
+
+	template<typename M>
+	std::pair<ObjMap::iterator, bool> ObjMap::insert_or_assign(Str key, M&& node) {
+		if (size_t pos = findPos(key.view()); pos != NoPos) {
+			items[pos].second = std::forward<M>(node);
+			return { items.begin() + pos, false };
+		}
+		return { append(std::move(key), Node(std::forward<M>(node))), true };
+	}
+
+	template<typename... Args>
+	std::pair<ObjMap::iterator, bool> ObjMap::emplace(Str key, Args&&... args) {
+		if (size_t pos = findPos(key.view()); pos != NoPos) {
+			return { items.begin() + pos, false };
+		}
+		return { append(std::move(key), Node(std::forward<Args>(args)...)), true };
+	}
+
+	// monotonic memory for decoded documents: allocation is a pointer bump and nodes are never freed one by one.
+	// reset() releases everything at once and keeps the buffer (grown to the largest use so far),
+	// so a worker thread decoding similar requests makes no heap allocations in steady state.
+	// Documents decoded into arena should not be read after its reset() or destruction (but may be destroyed).
+	class JsonArena {
+	public:
+		JsonArena(size_t initialSize = 64 * 1024);
+		JsonArena(const JsonArena&) = delete;
+		JsonArena& operator=(const JsonArena&) = delete;
+		inline std::pmr::memory_resource* resource() { return &mono.value(); }
+		void reset();
+		inline size_t capacity() const { return bufferSize; }
+		// arena of calling thread
+		static JsonArena& local();
+	private:
+		// heap memory, requested when buffer is exhausted
+		class Upstream : public std::pmr::memory_resource {
+		public:
+			size_t allocated = 0;
+		private:
+			void* do_allocate(size_t bytes, size_t alignment) override;
+			void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+		};
+		std::unique_ptr<std::byte[]> buffer;
+		size_t bufferSize;
+		Upstream upstream;
+		std::optional<std::pmr::monotonic_buffer_resource> mono;
+	};
+
+	// dictionary of object keys shared by decoders (JsonDecoder::Opts::keys), f.e. decoding many records of the same schema.
+	// Each distinct key is stored once and keys of decoded documents borrow it, so they take no memory of their own
+	// and equal keys are compared by pointer. Thread-safe; each decoder keeps a cache of keys it has seen,
+	// so known keys are resolved without locking. Documents keep the pool alive.
+	// Number and length of keys are limited; other keys (and keys with escape sequences) are copied as usual
+	class JsonKeyPool {
+	public:
+		struct Stats {
+			// keys found in pool
+			size_t hits = 0;
+			// keys added to pool or copied
+			size_t misses = 0;
+			// distinct keys in pool and their total size
+			size_t keys = 0;
+			size_t bytes = 0;
+			inline double hitRate() const { return hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0; }
+		};
+
+		// front of pool used by one decoder (thread)
+		class Cache {
+		public:
+			explicit Cache(std::shared_ptr<JsonKeyPool> pool);
+			// 'raw' - key as in json text. nullopt if it has escape sequences or can't be added to pool
+			std::optional<std::string_view> intern(std::string_view raw);
+			// adds counters to stats of pool
+			void flushStats();
+			inline const std::shared_ptr<JsonKeyPool>& pool() const { return _pool; }
+		private:
+			static constexpr size_t Size = 256;
+			std::shared_ptr<JsonKeyPool> _pool;
+			// direct-mapped by key hash
+			std::array<std::string_view, Size> slots;
+			size_t hits = 0;
+			size_t misses = 0;
+		};
+
+		JsonKeyPool(size_t maxKeys = 64 * 1024, size_t maxKeySize = 256);
+		JsonKeyPool(const JsonKeyPool&) = delete;
+		JsonKeyPool& operator=(const JsonKeyPool&) = delete;
+		// key stored in pool, nullopt if pool is full or key is too long. 'key' should be valid utf-8 without escaping
+		std::optional<std::string_view> intern(std::string_view key);
+		Stats stats() const;
+	private:
+		std::optional<std::string_view> internImpl(std::string_view key, bool& found);
+		size_t maxKeys;
+		size_t maxKeySize;
+		mutable std::shared_mutex mutex;
+		// characters of keys, never freed until pool is destroyed
+		std::pmr::monotonic_buffer_resource storage;
+		std::unordered_set<std::string_view> keys;
+		size_t bytes = 0;
+		std::atomic<size_t> hits = 0;
+		std::atomic<size_t> misses = 0;
+	};
+
+	// segment of compiled path
+	struct PathSegment {
+		std::string_view key;
+		// utils::hashKey(key)
+		size_t hash = 0;
+		// for arrays - parsed '[n]'
+		std::optional<size_t> idx;
+	};
+
+	namespace utils {
+		// index of '[n]' path segment
+		constexpr std::optional<size_t> parseIdx(std::string_view v) {
+			// plain loops - string_view searches are not constant expressions in some compilers
+			size_t pos1 = v.npos, pos2 = v.npos;
+			for (size_t i = 0; i < v.size(); ++i) {
+				if (v[i] == '[') {
+					pos1 = i;
+				}
+				else if (v[i] == ']') {
+					pos2 = i;
+				}
+			}
+			if (pos1 == v.npos || pos2 == v.npos || pos1 + 1 >= pos2) {
+				return std::nullopt;
+			}
+			size_t res = 0;
+			for (size_t i = pos1 + 1; i < pos2; ++i) {
+				if (v[i] < '0' || v[i] > '9') {
+					return std::nullopt;
+				}
+				res = res * 10 + (v[i] - '0');
+			}
+			return res;
+		}
+
+		constexpr size_t countSegments(std::string_view path) {
+			return path.empty() ? 0 : std::count(path.begin(), path.end(), '.') + 1;
+		}
+
+		// calls 'f' with every PathSegment of 'path' ('.' delimiter)
+		template<typename F>
+		constexpr void forEachSegment(std::string_view path, F f) {
+			if (path.empty()) {
+				return;
+			}
+			size_t start = 0;
+			for (size_t i = 0; i <= path.size(); ++i) {
+				if (i == path.size() || path[i] == '.') {
+					std::string_view key = path.substr(start, i - start);
+					f(PathSegment{ key, hashKey(key), parseIdx(key) });
+					start = i + 1;
+				}
+			}
+		}
+	}
+
+	// path compiled once, for lookups repeated many times: keys are split, indexes parsed and key hashes computed.
+	// Json lookups by compiled path make no allocations. Paths known at compile time - see jsonPath
+	class JsonPath {
+	public:
+		JsonPath();
+		// same syntax as Json::get(): '.' delimiter and '[]' indexes
+		JsonPath(std::string_view path);
+		JsonPath(const char* path);
+		inline std::span<const PathSegment> segments() const { return segs; }
+		inline operator std::span<const PathSegment>() const { return segs; }
+		inline std::string_view text() const { return path ? std::string_view(*path) : std::string_view(); }
+	private:
+		// segments point into text, which is shared by copies
+		std::shared_ptr<const std::string> path;
+		std::vector<PathSegment> segs;
+	};
+
+	// string literal as template parameter
+	template<size_t L>
+	struct PathLiteral {
+		char chars[L];
+		consteval PathLiteral(const char(&s)[L]) {
+			std::copy_n(s, L, chars);
+		}
+		constexpr std::string_view view() const { return std::string_view(chars, L - 1); }
+	};
+
+	// path compiled at compile time: json.as<int64_t>(jsonPath<"friends.[1].id">)
+	template<PathLiteral P>
+	inline constexpr auto jsonPath = []() {
+		std::array<PathSegment, utils::countSegments(P.view())> res;
+		size_t i = 0;
+		utils::forEachSegment(P.view(), [&](const PathSegment& seg) { res[i++] = seg; });
+		return res;
+	}();
+
+	template<typename Format>
+	class BinaryDecoder;
+
+	// copy shares containers of tree (see ArrNode), so it is O(1). Non-const get() and find() copy shared containers
+	// on the way to node, so modification of a copy doesn't change other documents.
+	// Document decoded into arena is copied to heap by non-const get() and find() - read it through const Json&
 	class Json {
 		friend class JsonDecoder;
 		friend class JsonEncoder;
+		template<typename Format>
+		friend class BinaryDecoder;
 	public:
 		Json();
 		Json(Node& r);
 		Json(Node&& r);
+		Json(const Json& other);
+		Json(Json&& other) = default;
+		Json& operator=(const Json& other);
+		Json& operator=(Json&& other) = default;
 
 		template<typename T>
-		T as();
+		T as() const;
 		template<typename T>
-		T as(const std::string& key);
+		T as(const std::string& key) const;
 		template<typename T, StringVector Cont>
-		T as(const Cont& keys);
+		T as(const Cont& keys) const;
 
 		bool empty() const;
 
-		std::vector<std::string> keys(const std::string& key);
+		std::vector<std::string> keys(const std::string& key) const;
 		template<StringVector Cont>
-		std::vector<std::string> keys(const Cont& keys);
+		std::vector<std::string> keys(const Cont& keys) const;
 
-		size_t arrSize(const std::string& key);
+		size_t arrSize(const std::string& key) const;
 		template<StringVector Cont>
-		size_t arrSize(const Cont& keys);
+		size_t arrSize(const Cont& keys) const;
 
+		const Node& get(const std::string& key) const;
 		Node& get(const std::string& key);
 		template<StringVector Cont>
+		const Node& get(const Cont& keys) const;
+		template<StringVector Cont>
 		Node& get(const Cont& keys);
-		inline Node& get() { return root.value(); }
+		inline const Node& get() const { return *root; }
+		Node& get();
+
+		// compiled path (JsonPath or jsonPath<"...">) - keys are searched by precomputed hashes
+		template<typename T>
+		T as(std::span<const PathSegment> path) const;
+		const Node& get(std::span<const PathSegment> path) const;
+		Node& get(std::span<const PathSegment> path);
+
+		// same as get(), but nullptr instead of std::out_of_range if there is no such node - for optional keys
+		const Node* find(const std::string& key) const;
+		Node* find(const std::string& key);
+		template<StringVector Cont>
+		const Node* find(const Cont& keys) const;
+		template<StringVector Cont>
+		Node* find(const Cont& keys);
+		const Node* find(std::span<const PathSegment> path) const;
+		Node* find(std::span<const PathSegment> path);
 	private:
+		// document with tree placed in arena
+		Json(Node&& r, JsonArena& arena);
+		// owner of memory which strings of document borrow
+		std::shared_ptr<const void> source;
+		// pool which keys of document borrow
+		std::shared_ptr<const JsonKeyPool> keyPool;
+		// tree in arena is not destroyed with document - arena frees its memory at once (also before the document).
+		// Non-const access to existing node moves tree out of arena first, because modified nodes may hold memory
+		// outside of it. Reading (as(), keys(), arrSize(), const get() and find()) keeps tree in arena
+		struct ArenaDeleter {
+			inline void operator()(Node*) const {}
+		};
+		inline bool inArena() const { return std::get_deleter<ArenaDeleter>(root) != nullptr; }
+		void onModify();
 		template<StringVector Cont >
-		Node& _getImpl(const Cont& keys);
+		const Node& _getImpl(const Cont& keys) const;
+		template<StringVector Cont >
+		const Node* _findImpl(const Cont& keys) const;
+		const Node* _findImpl(std::span<const PathSegment> path) const;
 		template<typename T>
-		T _asImpl(Node& node);
+		T _asImpl(const Node& node) const;
 		std::vector<std::string> _keysImpl(const Node& node) const;
-		size_t _arrSizeImpl(Node& node);
-		std::optional<Node> root;
+		size_t _arrSizeImpl(const Node& node) const;
+		std::shared_ptr<Node> root;
 	};
 
 	template<typename T>
 	std::vector<T> ArrNode::as() const {
 		std::vector<T> res;
-		for (const Node& node : val) {
+		for (const Node& node : ccont()) {
 			const ValNode& val = std::get<ValNode>(node);
 			res.push_back(val.as<T>());
 		}
 		return res;
 	}
 
+	template<StringVector Cont>
+	const Node& Json::get(const Cont& keys) const {
+		return _getImpl(keys);
+	}
+
 	template<StringVector Cont>
 	Node& Json::get(const Cont& keys) {
-		return  _getImpl(keys);
+		if (Node* node = find(keys); node) {
+			return *node;
+		}
+		throw std::out_of_range("couldn't get node");
 	}
 
 	template<StringVector Cont>
-	Node& Json::_getImpl(const Cont& keys) {
-		Node* curNode = &(root.value());
+	const Node* Json::find(const Cont& keys) const {
+		return _findImpl(keys);
+	}
+
+	template<StringVector Cont>
+	Node* Json::find(const Cont& keys) {
+		// arena document isn't moved to heap if there is no such node
+		if (inArena() && !_findImpl(keys)) {
+			return nullptr;
+		}
+		onModify();
+		// non-const access copies containers shared with other documents
+		Node* curNode = root.get();
 		for (auto& key : keys) {
-			if (std::holds_alternative<ObjNode>(*curNode)) {
-				curNode = &(std::get<ObjNode>(*curNode).cont().at(std::string(key.begin(), key.end())));
+			if (auto obj = std::get_if<ObjNode>(curNode); obj) {
+				curNode = obj->find(std::string_view(key.data(), key.size()));
 			}
-			else if (std::holds_alternative<ArrNode>(*curNode)) {
-				if (auto idx = utils::getIdx(key); idx) {
-					curNode = &(std::get<ArrNode>(*curNode).cont().at(idx.value()));
-				}
-				else {
-					throw std::out_of_range("couldn't get node");
-				}
+			else if (auto arr = std::get_if<ArrNode>(curNode); arr) {
+				auto idx = utils::getIdx(key);
+				curNode = (idx && *idx < arr->size()) ? &arr->cont()[*idx] : nullptr;
 			}
 			else {
-				throw std::out_of_range("couldn't get node");
+				curNode = nullptr;
+			}
+			if (!curNode) {
+				return nullptr;
+			}
+		}
+		return curNode;
+	}
+
+	template<StringVector Cont>
+	const Node& Json::_getImpl(const Cont& keys) const {
+		if (const Node* node = _findImpl(keys); node) {
+			return *node;
+		}
+		throw std::out_of_range("couldn't get node");
+	}
+
+	template<StringVector Cont>
+	const Node* Json::_findImpl(const Cont& keys) const {
+		const Node* curNode = root.get();
+		for (auto& key : keys) {
+			if (auto obj = std::get_if<ObjNode>(curNode); obj) {
+				curNode = obj->find(std::string_view(key.data(), key.size()));
+			}
+			else if (auto arr = std::get_if<ArrNode>(curNode); arr) {
+				auto idx = utils::getIdx(key);
+				curNode = (idx && *idx < arr->ccont().size()) ? &arr->ccont()[*idx] : nullptr;
+			}
+			else {
+				curNode = nullptr;
+			}
+			if (!curNode) {
+				return nullptr;
 			}
 		}
-		return *curNode;
+		return curNode;
 	}
 
 	template<typename T>
-	T Json::as() {
-		return _asImpl<T>(root.value());
+	T Json::as() const {
+		return _asImpl<T>(*root);
 	}
 
 	// limitations - '.' delimiter and '[]' indexes
 	template<typename T>
-	T Json::as(const std::string& key) {
-		Node& node = get(key);
+	T Json::as(const std::string& key) const {
+		const Node& node = get(key);
 		return _asImpl<T>(node);
 	}
 
 	template<typename T, StringVector Cont>
-	T Json::as(const Cont& keys) {
-		Node& node = get(keys);
+	T Json::as(const Cont& keys) const {
+		const Node& node = get(keys);
 		return _asImpl<T>(node);
 	}
 
+	template<typename T>
+	T Json::as(std::span<const PathSegment> path) const {
+		return _asImpl<T>(get(path));
+	}
+
 	template<StringVector Cont>
-	std::vector<std::string> Json::keys(const Cont& keys) {
+	std::vector<std::string> Json::keys(const Cont& keys) const {
 		const Node& node = get(keys);
 		return _keysImpl(node);
 	}
 
 	template<StringVector Cont>
-	size_t Json::arrSize(const Cont& keys) {
-		Node& node = get(keys);
+	size_t Json::arrSize(const Cont& keys) const {
+		const Node& node = get(keys);
 		return _arrSizeImpl(node);
 	}
 
 	template<typename T>
-	T Json::_asImpl(Node& node) {
-		if constexpr (util::traits::IsOneOfVariants<T, ValNode::Val>::value) {
+	T Json::_asImpl(const Node& node) const {
+		if constexpr (util::traits::IsOneOfVariants<T, ValNode::Val>::value || ValueStringType<T>) {
 			if (std::holds_alternative<ValNode>(node)) {
 				return std::get<ValNode>(node).as<T>();
 			}
@@ -304,29 +840,64 @@ namespace util::web::json {
 
 	class JsonDecoder {
 	public:
+		struct Opts {
+			// find strings' ends with vectorized structural index (JsonSimd.hpp) instead of scanning them
+			bool structuralIndex = true;
+			// keys of objects are interned in pool (JsonKeyPool), which may be shared by decoders of many threads
+			std::shared_ptr<JsonKeyPool> keys = nullptr;
+			// root array or object of at least 'parallelMinSize' bytes is cut into parts decoded by 'threads' threads
+			// (0 - number of cores). Not used when decoding into arena
+			size_t threads = 1;
+			size_t parallelMinSize = 1024 * 1024;
+		};
 		JsonDecoder();
+		JsonDecoder(const Opts& opts);
 		Json decode(std::string_view v);
+		// all nodes and strings of result are allocated in 'arena'
+		Json decode(std::string_view v, JsonArena& arena);
+		// strings and keys of result borrow memory of 'v' instead of copying (strings with escape sequences are still copied).
+		// 'source' should own that memory (f.e. storage of InputSocketBuffer) - result keeps it alive
+		Json decode(std::string_view v, std::shared_ptr<const void> source);
+		Json decode(std::string_view v, std::shared_ptr<const void> source, JsonArena& arena);
 		Json decode(std::ifstream& is);
 		Json decode(std::ifstream&& is);
+		// file is memory-mapped (MappedFile.hpp) and decoded right from the mapping, without copying it.
+		// If 'borrowStrings' - strings of result borrow the mapping, which is kept alive by result
+		Json decodeFile(const std::string& path, bool borrowStrings = false);
 	private:
-		Node decodeImpl(std::string_view v);
-		Node decodeObj(std::string_view v);
-		Node decodeArr(std::string_view v);
-		Node decodeInt(std::string_view v);
-		Node decodeFloat(std::string_view v);
-		Node decodeStr(std::string_view v);
-		Node decodeBool(std::string_view v);
-		Node decodeNull(std::string_view v);
+		// parses with SaxParser and DomBuilder (JsonSax.hpp)
+		Node decodeRoot(std::string_view v);
+		// nullopt if root isn't a container or can't be cut into parts
+		std::optional<Node> decodeParallel(std::string_view v);
+		// adds pool of keys to document
+		Json withKeys(Json&& res);
+		Opts opts;
+		std::optional<JsonKeyPool::Cache> keyCache;
+		// memory for nodes of document being decoded
+		std::pmr::memory_resource* mem = std::pmr::get_default_resource();
+		bool borrowStrings = false;
 	};
 
 	class JsonEncoder {
 	public:
 		struct Opts {
 			bool humanReadable = false;
+			// approximate size of chunks passed to JsonWriter
+			size_t chunkSize = 64 * 1024;
+			// arrays of at least 'parallelMinSize' elements are encoded by 'threads' threads (0 - number of cores):
+			// ranges of elements go to separate buffers, which are appended to output in order
+			// (or passed to JsonWriter::writeChunks() together with preceding output)
+			size_t threads = 1;
+			size_t parallelMinSize = 4096;
 		};
 		JsonEncoder();
 		JsonEncoder(const Opts& opts);
 		std::string encode(const Json& json);
+		// appends to 'out'; reusing it between calls makes encoding allocation-free
+		void encode(const Json& json, std::string& out);
+		// passes output to 'writer' (JsonWriter.hpp) in chunks while encoding, so only about one chunk is kept in memory.
+		// Chunk can exceed opts.chunkSize by size of one scalar value
+		void encode(const Json& json, JsonWriter& writer);
 		void dump(const Json& json, std::ostream& os);
 		void dump(const Json& json, std::ostream&& os);
 	private:
@@ -335,13 +906,29 @@ namespace util::web::json {
 		void encodeBool(std::string& s, const ValNode& node);
 		void encodeInt(std::string& s, const ValNode& node);
 		void encodeFloat(std::string& s, const ValNode& node);
-		void encodeStr(std::string& s, const ValNode& node);
+		// escapes and validates utf-8 (JsonSimd.hpp); used for keys too
+		void encodeStr(std::string& s, std::string_view v);
 		template <bool Hr>
 		void encodeArray(std::string& s, const ArrNode& node);
+		// elements [from, to) with separators
+		template <bool Hr>
+		void encodeElements(std::string& s, const ArrNode::Container& nodes, size_t from, size_t to);
+		void encodeElementsParallel(std::string& s, const ArrNode::Container& nodes);
 		template <bool Hr>
 		void encodeObj(std::string& s, const ObjNode& node);
 		void appendIntendation(std::string& s);
+		inline void flushIfFull(std::string& s) {
+			if (writer && s.size() >= opts.chunkSize) {
+				flush(s);
+			}
+		}
+		void flush(std::string& s);
 		Opts opts;
+		// set while encoding to writer
+		JsonWriter* writer = nullptr;
+		// size of previous result - documents encoded by the same encoder are usually alike,
+		// so output is reserved once (walking nodes to compute exact size costs more than it saves)
+		size_t lastSize = 0;
 		struct EncodingCtx {
 			size_t intendationLvl = 0;
 			void reset();
@@ -351,42 +938,55 @@ namespace util::web::json {
 	template <bool Hr>
 	void JsonEncoder::encodeArray(std::string& s, const ArrNode& node) {
 		++ctx.intendationLvl;
-		s.append("[");
-		if constexpr (Hr) s.append("\n");
+		s.push_back('[');
+		if constexpr (Hr) s.push_back('\n');
 		const auto& arrNodes = node.ccont();
-		for (size_t i = 0; i < arrNodes.size(); ++i) {
-			if constexpr (Hr) appendIntendation(s);
-			encodeImpl(s, arrNodes[i]);
-			if (i < (arrNodes.size() - 1)) {
-				s.append(",");
-			}
-			if constexpr (Hr) s.append("\n");
+		if (opts.threads != 1 && arrNodes.size() >= opts.parallelMinSize) {
+			encodeElementsParallel(s, arrNodes);
+		}
+		else {
+			encodeElements<Hr>(s, arrNodes, 0, arrNodes.size());
 		}
 		--ctx.intendationLvl;
 		if constexpr (Hr) appendIntendation(s);
-		s.append("]");
+		s.push_back(']');
+	}
+
+	template <bool Hr>
+	void JsonEncoder::encodeElements(std::string& s, const ArrNode::Container& nodes, size_t from, size_t to) {
+		for (size_t i = from; i < to; ++i) {
+			if constexpr (Hr) appendIntendation(s);
+			encodeImpl(s, nodes[i]);
+			flushIfFull(s);
+			if (i < (nodes.size() - 1)) {
+				s.push_back(',');
+			}
+			if constexpr (Hr) s.push_back('\n');
+		}
 	}
 
 	template <bool Hr>
 	void JsonEncoder::encodeObj(std::string& s, const ObjNode& node) {
 		++ctx.intendationLvl;
-		s.append("{");
-		if constexpr (Hr)  s.append("\n");
+		s.push_back('{');
+		if constexpr (Hr)  s.push_back('\n');
 		const auto& objItems = node.ccont();
 		size_t i = 0;
 		for (const auto& [key, curNode] : objItems) {
 			if constexpr (Hr)  appendIntendation(s);
-			s.append(std::format("\"{}\":", key));
+			encodeStr(s, key.view());
+			s.push_back(':');
 			encodeImpl(s, curNode);
+			flushIfFull(s);
 			if (i < objItems.size() - 1) {
-				s.append(",");
+				s.push_back(',');
 			}
 			++i;
-			if constexpr (Hr)  s.append("\n");
+			if constexpr (Hr)  s.push_back('\n');
 		}
 		--ctx.intendationLvl;
 		if constexpr (Hr)  appendIntendation(s);
-		s.append("}");
+		s.push_back('}');
 	}
 
 }
@@ -0,0 +1,677 @@
+#include "JsonBinary.hpp"
+#include "JsonSimd.hpp"
+#include "JsonWriter.hpp"
+#include <stdexcept>
+#include <format>
+#include <limits>
+#include <bit>
+#include <cmath>
+
+using namespace util::web::json;
+
+namespace util::web::json::binary {
+
+	// data has ended in the middle of document while its size is computed
+	struct Incomplete {
+
+	};
+
+	class Reader {
+	public:
+		// if 'partial' - end of data throws Incomplete instead of std::runtime_error
+		Reader(std::string_view v, const char* format, bool partial)
+			: v{ v }, format{ format }, partial{ partial }
+		{
+
+		}
+		inline uint8_t byte() {
+			need(1);
+			return static_cast<uint8_t>(v[pos++]);
+		}
+		// big-endian unsigned integer of 'n' bytes
+		inline uint64_t be(size_t n) {
+			need(n);
+			uint64_t res = 0;
+			for (size_t i = 0; i < n; ++i) {
+				res = (res << 8) | static_cast<uint8_t>(v[pos + i]);
+			}
+			pos += n;
+			return res;
+		}
+		inline std::string_view bytes(size_t n) {
+			need(n);
+			std::string_view res = v.substr(pos, n);
+			pos += n;
+			return res;
+		}
+		inline size_t position() const { return pos; }
+		inline size_t remaining() const { return v.size() - pos; }
+		[[noreturn]] void fail(std::string_view what) const {
+			throw std::runtime_error(std::format("{}: {} at position {}", format, what, pos));
+		}
+	private:
+		inline void need(size_t n) {
+			if (n > v.size() - pos) {
+				if (partial) {
+					throw Incomplete();
+				}
+				fail("unexpected end of data");
+			}
+		}
+		std::string_view v;
+		size_t pos = 0;
+		const char* format;
+		bool partial;
+	};
+
+	struct Item {
+		enum class Kind {
+			Null,
+			Bool,
+			Int,
+			Float,
+			Str,
+			Arr,
+			Obj,
+			// end of indefinite-length item
+			Break
+		};
+		Kind kind;
+		bool b = false;
+		int64_t i = 0;
+		double d = 0.0;
+		// elements of array, members of map or bytes of string
+		size_t size = 0;
+		// items follow until Break (CBOR)
+		bool indefinite = false;
+	};
+
+	inline void appendBe(std::string& s, uint64_t v, size_t n) {
+		char buf[8];
+		for (size_t i = 0; i < n; ++i) {
+			buf[i] = static_cast<char>(v >> (8 * (n - 1 - i)));
+		}
+		s.append(buf, n);
+	}
+
+	struct Cbor {
+		static constexpr const char* Name = "CBOR";
+
+		// major type and its argument in the shortest form
+		static inline void writeHeader(std::string& s, uint8_t major, uint64_t n) {
+			major <<= 5;
+			if (n < 24) {
+				s.push_back(static_cast<char>(major | n));
+			}
+			else if (n <= 0xff) {
+				s.push_back(static_cast<char>(major | 24));
+				appendBe(s, n, 1);
+			}
+			else if (n <= 0xffff) {
+				s.push_back(static_cast<char>(major | 25));
+				appendBe(s, n, 2);
+			}
+			else if (n <= 0xffffffff) {
+				s.push_back(static_cast<char>(major | 26));
+				appendBe(s, n, 4);
+			}
+			else {
+				s.push_back(static_cast<char>(major | 27));
+				appendBe(s, n, 8);
+			}
+		}
+		static inline void writeNull(std::string& s) { s.push_back('\xf6'); }
+		static inline void writeBool(std::string& s, bool b) { s.push_back(b ? '\xf5' : '\xf4'); }
+		static inline void writeInt(std::string& s, int64_t i) {
+			if (i >= 0) {
+				writeHeader(s, 0, static_cast<uint64_t>(i));
+			}
+			else {
+				// -1 - n
+				writeHeader(s, 1, static_cast<uint64_t>(-(i + 1)));
+			}
+		}
+		static inline void writeFloat(std::string& s, double d) {
+			s.push_back('\xfb');
+			appendBe(s, std::bit_cast<uint64_t>(d), 8);
+		}
+		static inline void writeStrHeader(std::string& s, size_t n) { writeHeader(s, 3, n); }
+		static inline void writeArrHeader(std::string& s, size_t n) { writeHeader(s, 4, n); }
+		static inline void writeObjHeader(std::string& s, size_t n) { writeHeader(s, 5, n); }
+
+		static inline uint64_t readArg(Reader& r, uint8_t info) {
+			if (info < 24) {
+				return info;
+			}
+			if (info > 27) {
+				r.fail("invalid additional information");
+			}
+			return r.be(size_t(1) << (info - 24));
+		}
+
+		// RFC 8949, appendix D
+		static inline double halfToDouble(uint16_t h) {
+			int exp = (h >> 10) & 0x1f;
+			int mant = h & 0x3ff;
+			double val = 0.0;
+			if (exp == 0) {
+				val = std::ldexp(mant, -24);
+			}
+			else if (exp != 31) {
+				val = std::ldexp(mant + 1024, exp - 25);
+			}
+			else {
+				val = mant == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+			}
+			return (h & 0x8000) ? -val : val;
+		}
+
+		static Item readItem(Reader& r) {
+			uint8_t initial = r.byte();
+			// tags (f.e. of date/time) are skipped - tagged value is read as is
+			while ((initial >> 5) == 6) {
+				readArg(r, initial & 0x1f);
+				initial = r.byte();
+			}
+			uint8_t major = initial >> 5;
+			uint8_t info = initial & 0x1f;
+			if (major == 7) {
+				switch (info) {
+				case 20:
+					return { .kind = Item::Kind::Bool, .b = false };
+				case 21:
+					return { .kind = Item::Kind::Bool, .b = true };
+				// null and undefined
+				case 22:
+				case 23:
+					return { .kind = Item::Kind::Null };
+				case 25:
+					return { .kind = Item::Kind::Float, .d = halfToDouble(static_cast<uint16_t>(r.be(2))) };
+				case 26:
+					return { .kind = Item::Kind::Float, .d = std::bit_cast<float>(static_cast<uint32_t>(r.be(4))) };
+				case 27:
+					return { .kind = Item::Kind::Float, .d = std::bit_cast<double>(r.be(8)) };
+				case 31:
+					return { .kind = Item::Kind::Break };
+				default:
+					r.fail("unsupported simple value");
+				}
+			}
+			if (major == 2) {
+				r.fail("byte strings are not supported");
+			}
+			if (info == 31) {
+				if (major < 3) {
+					r.fail("invalid indefinite length");
+				}
+				return { .kind = major == 3 ? Item::Kind::Str : (major == 4 ? Item::Kind::Arr : Item::Kind::Obj), .indefinite = true };
+			}
+			uint64_t arg = readArg(r, info);
+			constexpr uint64_t MaxInt = std::numeric_limits<int64_t>::max();
+			switch (major) {
+			case 0:
+				if (arg > MaxInt) {
+					return { .kind = Item::Kind::Float, .d = static_cast<double>(arg) };
+				}
+				return { .kind = Item::Kind::Int, .i = static_cast<int64_t>(arg) };
+			case 1:
+				if (arg > MaxInt) {
+					return { .kind = Item::Kind::Float, .d = -1.0 - static_cast<double>(arg) };
+				}
+				return { .kind = Item::Kind::Int, .i = -1 - static_cast<int64_t>(arg) };
+			case 3:
+				return { .kind = Item::Kind::Str, .size = arg };
+			case 4:
+				return { .kind = Item::Kind::Arr, .size = arg };
+			default:
+				return { .kind = Item::Kind::Obj, .size = arg };
+			}
+		}
+	};
+
+	struct Msgpack {
+		static constexpr const char* Name = "MessagePack";
+
+		static inline void writeNull(std::string& s) { s.push_back('\xc0'); }
+		static inline void writeBool(std::string& s, bool b) { s.push_back(b ? '\xc3' : '\xc2'); }
+		static inline void writeInt(std::string& s, int64_t i) {
+			if (i >= 0) {
+				if (i < 128) {
+					s.push_back(static_cast<char>(i));
+				}
+				else {
+					writeSized(s, static_cast<uint64_t>(i), '\xcc', '\xcd', '\xce', '\xcf');
+				}
+			}
+			else if (i >= -32) {
+				s.push_back(static_cast<char>(i));
+			}
+			else if (i >= std::numeric_limits<int8_t>::min()) {
+				s.push_back('\xd0');
+				appendBe(s, static_cast<uint64_t>(i), 1);
+			}
+			else if (i >= std::numeric_limits<int16_t>::min()) {
+				s.push_back('\xd1');
+				appendBe(s, static_cast<uint64_t>(i), 2);
+			}
+			else if (i >= std::numeric_limits<int32_t>::min()) {
+				s.push_back('\xd2');
+				appendBe(s, static_cast<uint64_t>(i), 4);
+			}
+			else {
+				s.push_back('\xd3');
+				appendBe(s, static_cast<uint64_t>(i), 8);
+			}
+		}
+		static inline void writeFloat(std::string& s, double d) {
+			s.push_back('\xcb');
+			appendBe(s, std::bit_cast<uint64_t>(d), 8);
+		}
+		static inline void writeStrHeader(std::string& s, size_t n) {
+			if (n < 32) {
+				s.push_back(static_cast<char>(0xa0 | n));
+			}
+			else {
+				writeSized(s, checkSize(n), '\xd9', '\xda', '\xdb');
+			}
+		}
+		static inline void writeArrHeader(std::string& s, size_t n) {
+			if (n < 16) {
+				s.push_back(static_cast<char>(0x90 | n));
+			}
+			else {
+				writeSized(s, checkSize(n), 0, '\xdc', '\xdd');
+			}
+		}
+		static inline void writeObjHeader(std::string& s, size_t n) {
+			if (n < 16) {
+				s.push_back(static_cast<char>(0x80 | n));
+			}
+			else {
+				writeSized(s, checkSize(n), 0, '\xde', '\xdf');
+			}
+		}
+		// shortest of 1, 2, 4 and 8 bytes forms ('0' - form is absent)
+		static inline void writeSized(std::string& s, uint64_t n, char type1, char type2, char type4, char type8 = 0) {
+			if (type1 && n <= 0xff) {
+				s.push_back(type1);
+				appendBe(s, n, 1);
+			}
+			else if (n <= 0xffff) {
+				s.push_back(type2);
+				appendBe(s, n, 2);
+			}
+			else if (n <= 0xffffffff || !type8) {
+				s.push_back(type4);
+				appendBe(s, n, 4);
+			}
+			else {
+				s.push_back(type8);
+				appendBe(s, n, 8);
+			}
+		}
+		static inline uint64_t checkSize(size_t n) {
+			if (n > 0xffffffff) {
+				throw std::runtime_error("MessagePack: size of string, array or map exceeds 32 bits");
+			}
+			return n;
+		}
+
+		static Item readItem(Reader& r) {
+			uint8_t type = r.byte();
+			if (type < 0x80) {
+				return { .kind = Item::Kind::Int, .i = type };
+			}
+			if (type >= 0xe0) {
+				return { .kind = Item::Kind::Int, .i = static_cast<int8_t>(type) };
+			}
+			if (type < 0x90) {
+				return { .kind = Item::Kind::Obj, .size = type & 0x0fu };
+			}
+			if (type < 0xa0) {
+				return { .kind = Item::Kind::Arr, .size = type & 0x0fu };
+			}
+			if (type < 0xc0) {
+				return { .kind = Item::Kind::Str, .size = type & 0x1fu };
+			}
+			switch (type) {
+			case 0xc0:
+				return { .kind = Item::Kind::Null };
+			case 0xc2:
+				return { .kind = Item::Kind::Bool, .b = false };
+			case 0xc3:
+				return { .kind = Item::Kind::Bool, .b = true };
+			case 0xca:
+				return { .kind = Item::Kind::Float, .d = std::bit_cast<float>(static_cast<uint32_t>(r.be(4))) };
+			case 0xcb:
+				return { .kind = Item::Kind::Float, .d = std::bit_cast<double>(r.be(8)) };
+			case 0xcc:
+			case 0xcd:
+			case 0xce:
+				return { .kind = Item::Kind::Int, .i = static_cast<int64_t>(r.be(size_t(1) << (type - 0xcc))) };
+			case 0xcf: {
+				uint64_t val = r.be(8);
+				if (val > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+					return { .kind = Item::Kind::Float, .d = static_cast<double>(val) };
+				}
+				return { .kind = Item::Kind::Int, .i = static_cast<int64_t>(val) };
+			}
+			case 0xd0:
+				return { .kind = Item::Kind::Int, .i = static_cast<int8_t>(r.be(1)) };
+			case 0xd1:
+				return { .kind = Item::Kind::Int, .i = static_cast<int16_t>(r.be(2)) };
+			case 0xd2:
+				return { .kind = Item::Kind::Int, .i = static_cast<int32_t>(r.be(4)) };
+			case 0xd3:
+				return { .kind = Item::Kind::Int, .i = static_cast<int64_t>(r.be(8)) };
+			case 0xd9:
+			case 0xda:
+			case 0xdb:
+				return { .kind = Item::Kind::Str, .size = r.be(size_t(1) << (type - 0xd9)) };
+			case 0xdc:
+				return { .kind = Item::Kind::Arr, .size = r.be(2) };
+			case 0xdd:
+				return { .kind = Item::Kind::Arr, .size = r.be(4) };
+			case 0xde:
+				return { .kind = Item::Kind::Obj, .size = r.be(2) };
+			case 0xdf:
+				return { .kind = Item::Kind::Obj, .size = r.be(4) };
+			default:
+				// binary strings and extension types
+				r.fail(std::format("unsupported type 0x{:02x}", type));
+			}
+		}
+	};
+
+}
+
+template<typename Format>
+BinaryEncoder<Format>::BinaryEncoder() {
+
+}
+
+template<typename Format>
+BinaryEncoder<Format>::BinaryEncoder(const Opts& opts)
+	: opts{ opts }
+{
+
+}
+
+template<typename Format>
+std::string BinaryEncoder<Format>::encode(const Json& json) {
+	std::string res;
+	encode(json, res);
+	return res;
+}
+
+template<typename Format>
+void BinaryEncoder<Format>::encode(const Json& json, std::string& out) {
+	if (json.empty()) {
+		return;
+	}
+	encodeImpl(out, json.get());
+}
+
+template<typename Format>
+void BinaryEncoder<Format>::encode(const Json& json, JsonWriter& out) {
+	std::string buf;
+	buf.reserve(opts.chunkSize);
+	writer = &out;
+	try {
+		encode(json, buf);
+	}
+	catch (...) {
+		writer = nullptr;
+		throw;
+	}
+	writer = nullptr;
+	if (!buf.empty()) {
+		out.write(buf);
+	}
+}
+
+template<typename Format>
+void BinaryEncoder<Format>::flush(std::string& s) {
+	writer->write(s);
+	s.clear();
+	// writer could have taken buffer's memory
+	s.reserve(opts.chunkSize);
+}
+
+template<typename Format>
+void BinaryEncoder<Format>::encodeImpl(std::string& s, const Node& node) {
+	if (auto val = std::get_if<ValNode>(&node); val) {
+		switch (val->type()) {
+		case NodeType::Null:
+			Format::writeNull(s);
+			break;
+		case NodeType::Bool:
+			Format::writeBool(s, val->as<bool>());
+			break;
+		case NodeType::Int:
+			Format::writeInt(s, val->as<int64_t>());
+			break;
+		case NodeType::Float:
+			Format::writeFloat(s, val->as<double>());
+			break;
+		case NodeType::String:
+			encodeStr(s, val->as<std::string_view>());
+			break;
+		default:
+			break;
+		}
+	}
+	else if (auto arr = std::get_if<ArrNode>(&node); arr) {
+		Format::writeArrHeader(s, arr->size());
+		for (const Node& elem : arr->ccont()) {
+			encodeImpl(s, elem);
+			flushIfFull(s);
+		}
+	}
+	else {
+		const auto& items = std::get<ObjNode>(node).ccont();
+		Format::writeObjHeader(s, items.size());
+		for (const auto& [key, elem] : items) {
+			encodeStr(s, key.view());
+			encodeImpl(s, elem);
+			flushIfFull(s);
+		}
+	}
+}
+
+template<typename Format>
+void BinaryEncoder<Format>::encodeStr(std::string& s, std::string_view v) {
+	// text strings of both formats are utf-8
+	simd::validateUtf8(v);
+	Format::writeStrHeader(s, v.size());
+	s.append(v);
+}
+
+template<typename Format>
+BinaryDecoder<Format>::BinaryDecoder() {
+
+}
+
+template<typename Format>
+BinaryDecoder<Format>::BinaryDecoder(const Opts& opts)
+	: opts{ opts }
+{
+
+}
+
+template<typename Format>
+Json BinaryDecoder<Format>::decode(std::string_view v) {
+	if (v.empty()) return Json();
+	mem = std::pmr::get_default_resource();
+	borrowStrings = false;
+	return Json(decodeRoot(v));
+}
+
+template<typename Format>
+Json BinaryDecoder<Format>::decode(std::string_view v, JsonArena& arena) {
+	if (v.empty()) return Json();
+	mem = arena.resource();
+	borrowStrings = false;
+	return Json(decodeRoot(v), arena);
+}
+
+template<typename Format>
+Json BinaryDecoder<Format>::decode(std::string_view v, std::shared_ptr<const void> source) {
+	if (v.empty()) return Json();
+	mem = std::pmr::get_default_resource();
+	borrowStrings = true;
+	Json res(decodeRoot(v));
+	res.source = std::move(source);
+	return res;
+}
+
+template<typename Format>
+size_t BinaryDecoder<Format>::decodeNext(std::string_view v, Json& out) {
+	size_t size = documentSize(v);
+	if (size != 0) {
+		out = decode(v.substr(0, size));
+	}
+	return size;
+}
+
+template<typename Format>
+Node BinaryDecoder<Format>::decodeRoot(std::string_view v) {
+	binary::Reader r(v, Format::Name, false);
+	Node res = decodeNode(r, Format::readItem(r), 0);
+	if (r.remaining() != 0) {
+		r.fail("unexpected data after document");
+	}
+	return res;
+}
+
+template<typename Format>
+Node BinaryDecoder<Format>::decodeNode(binary::Reader& r, const binary::Item& item, size_t depth) {
+	using Kind = binary::Item::Kind;
+	switch (item.kind) {
+	case Kind::Null:
+		return ValNode();
+	case Kind::Bool:
+		return ValNode(item.b);
+	case Kind::Int:
+		return ValNode(item.i);
+	case Kind::Float:
+		return ValNode(item.d);
+	case Kind::Str:
+		return ValNode(decodeStr(r, item));
+	case Kind::Arr: {
+		if (depth >= opts.maxDepth) {
+			r.fail("too deep nesting");
+		}
+		ArrNode arr(mem, borrowStrings);
+		auto& cont = arr.cont();
+		if (!item.indefinite) {
+			// each element takes at least a byte - size from invalid data can't make huge allocation
+			cont.reserve(std::min(item.size, r.remaining()));
+		}
+		for (size_t i = 0; item.indefinite || i < item.size; ++i) {
+			binary::Item elem = Format::readItem(r);
+			if (item.indefinite && elem.kind == Kind::Break) {
+				break;
+			}
+			cont.push_back(decodeNode(r, elem, depth + 1));
+		}
+		return arr;
+	}
+	case Kind::Obj: {
+		if (depth >= opts.maxDepth) {
+			r.fail("too deep nesting");
+		}
+		ObjNode obj(mem, borrowStrings);
+		auto& cont = obj.cont();
+		if (!item.indefinite) {
+			cont.reserve(std::min(item.size, r.remaining() / 2));
+		}
+		for (size_t i = 0; item.indefinite || i < item.size; ++i) {
+			binary::Item key = Format::readItem(r);
+			if (item.indefinite && key.kind == Kind::Break) {
+				break;
+			}
+			if (key.kind != Kind::Str) {
+				r.fail("keys of map should be strings");
+			}
+			Str keyStr = decodeStr(r, key);
+			cont.insert_or_assign(std::move(keyStr), decodeNode(r, Format::readItem(r), depth + 1));
+		}
+		return obj;
+	}
+	default:
+		r.fail("unexpected break");
+	}
+}
+
+template<typename Format>
+Str BinaryDecoder<Format>::decodeStr(binary::Reader& r, const binary::Item& item) {
+	if (!item.indefinite) {
+		std::string_view s = r.bytes(item.size);
+		simd::validateUtf8(s);
+		return borrowStrings ? Str::borrow(s) : Str(s, mem);
+	}
+	// chunks of indefinite-length string are joined
+	std::pmr::string res(mem);
+	for (;;) {
+		binary::Item chunk = Format::readItem(r);
+		if (chunk.kind == binary::Item::Kind::Break) {
+			break;
+		}
+		if (chunk.kind != binary::Item::Kind::Str || chunk.indefinite) {
+			r.fail("invalid chunk of string");
+		}
+		res.append(r.bytes(chunk.size));
+	}
+	simd::validateUtf8(res);
+	return Str(std::move(res));
+}
+
+template<typename Format>
+size_t BinaryDecoder<Format>::documentSize(std::string_view v) {
+	binary::Reader r(v, Format::Name, true);
+	try {
+		skipNode(r, Format::readItem(r), 0);
+	}
+	catch (const binary::Incomplete&) {
+		return 0;
+	}
+	return r.position();
+}
+
+template<typename Format>
+void BinaryDecoder<Format>::skipNode(binary::Reader& r, const binary::Item& item, size_t depth) {
+	using Kind = binary::Item::Kind;
+	switch (item.kind) {
+	case Kind::Str:
+		if (!item.indefinite) {
+			r.bytes(item.size);
+			return;
+		}
+		[[fallthrough]];
+	case Kind::Arr:
+	case Kind::Obj: {
+		if (depth >= opts.maxDepth) {
+			r.fail("too deep nesting");
+		}
+		size_t count = item.kind == Kind::Obj ? 2 * item.size : item.size;
+		for (size_t i = 0; item.indefinite || i < count; ++i) {
+			binary::Item elem = Format::readItem(r);
+			if (item.indefinite && elem.kind == Kind::Break) {
+				break;
+			}
+			skipNode(r, elem, depth + 1);
+		}
+		return;
+	}
+	case Kind::Break:
+		r.fail("unexpected break");
+	default:
+		return;
+	}
+}
+
+template class util::web::json::BinaryEncoder<binary::Cbor>;
+template class util::web::json::BinaryDecoder<binary::Cbor>;
+template class util::web::json::BinaryEncoder<binary::Msgpack>;
+template class util::web::json::BinaryDecoder<binary::Msgpack>;
@@ -0,0 +1,92 @@
+#pragma once
+#include "Json.hpp"
+
+namespace util::web::json {
+
+	class JsonWriter;
+
+	// formats of binary encoding (parameters of BinaryEncoder and BinaryDecoder)
+	namespace binary {
+		// RFC 8949
+		struct Cbor;
+		struct Msgpack;
+		// decoding state and header of value (JsonBinary.cpp)
+		class Reader;
+		struct Item;
+	}
+
+	// binary encoding of Json tree, for traffic between own services: numbers are written raw (no formatting and parsing),
+	// strings are prefixed by size (no escaping). Doubles are always written in 8 bytes, so they are decoded exactly
+	template<typename Format>
+	class BinaryEncoder {
+	public:
+		struct Opts {
+			// approximate size of chunks passed to JsonWriter
+			size_t chunkSize = 64 * 1024;
+		};
+		BinaryEncoder();
+		BinaryEncoder(const Opts& opts);
+		std::string encode(const Json& json);
+		// appends to 'out'
+		void encode(const Json& json, std::string& out);
+		// passes output to 'writer' in chunks while encoding (as JsonEncoder does)
+		void encode(const Json& json, JsonWriter& writer);
+	private:
+		void encodeImpl(std::string& s, const Node& node);
+		void encodeStr(std::string& s, std::string_view v);
+		inline void flushIfFull(std::string& s) {
+			if (writer && s.size() >= opts.chunkSize) {
+				flush(s);
+			}
+		}
+		void flush(std::string& s);
+		Opts opts;
+		// set while encoding to writer
+		JsonWriter* writer = nullptr;
+	};
+
+	// builds the same tree as JsonDecoder. Strings are validated as utf-8, keys of maps should be strings.
+	// Integers which don't fit int64_t become doubles. Throws std::runtime_error on invalid or unsupported data
+	// (binary strings, extension types)
+	template<typename Format>
+	class BinaryDecoder {
+	public:
+		struct Opts {
+			// nesting of arrays and maps - decoder is recursive
+			size_t maxDepth = 1024;
+		};
+		BinaryDecoder();
+		BinaryDecoder(const Opts& opts);
+		// 'v' should hold exactly one document
+		Json decode(std::string_view v);
+		// all nodes and strings of result are allocated in 'arena'
+		Json decode(std::string_view v, JsonArena& arena);
+		// strings of result borrow memory of 'v', which 'source' should own (as in JsonDecoder)
+		Json decode(std::string_view v, std::shared_ptr<const void> source);
+		// streaming: documents follow each other (f.e. messages in InputSocketBuffer). Decodes the first document of 'v'
+		// to 'out' and returns its size, or returns 0 if 'v' doesn't hold the whole document yet
+		size_t decodeNext(std::string_view v, Json& out);
+	private:
+		Node decodeRoot(std::string_view v);
+		Node decodeNode(binary::Reader& r, const binary::Item& item, size_t depth);
+		Str decodeStr(binary::Reader& r, const binary::Item& item);
+		// size of the first document of 'v'; 0 if it is incomplete
+		size_t documentSize(std::string_view v);
+		void skipNode(binary::Reader& r, const binary::Item& item, size_t depth);
+		Opts opts;
+		// memory for nodes of document being decoded
+		std::pmr::memory_resource* mem = std::pmr::get_default_resource();
+		bool borrowStrings = false;
+	};
+
+	using CborEncoder = BinaryEncoder<binary::Cbor>;
+	using CborDecoder = BinaryDecoder<binary::Cbor>;
+	using MsgpackEncoder = BinaryEncoder<binary::Msgpack>;
+	using MsgpackDecoder = BinaryDecoder<binary::Msgpack>;
+
+	extern template class BinaryEncoder<binary::Cbor>;
+	extern template class BinaryDecoder<binary::Cbor>;
+	extern template class BinaryEncoder<binary::Msgpack>;
+	extern template class BinaryDecoder<binary::Msgpack>;
+
+}
@@ -0,0 +1,397 @@
+#include "JsonImage.hpp"
+#include <stdexcept>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace util::string;
+using namespace util::web::json;
+
+// serializes Node tree into image
+class JsonImage::Writer {
+public:
+	Writer()
+		: out(HeaderSize, '\0')
+	{
+
+	}
+	uint64_t writeNode(const Node& node) {
+		if (auto val = std::get_if<ValNode>(&node); val) {
+			switch (val->type()) {
+			case NodeType::Bool:
+				return makeRef(val->as<bool>() ? Tag::True : Tag::False, 0);
+			case NodeType::Int: {
+				int64_t i = val->as<int64_t>();
+				if (i >= SmallIntMin && i <= SmallIntMax) {
+					return makeRef(Tag::SmallInt, static_cast<uint64_t>(i));
+				}
+				uint64_t offset = alloc(sizeof(uint64_t));
+				put(offset, static_cast<uint64_t>(i));
+				return makeRef(Tag::Int, offset);
+			}
+			case NodeType::Float: {
+				uint64_t offset = alloc(sizeof(uint64_t));
+				double d = val->as<double>();
+				std::memcpy(out.data() + offset, &d, sizeof(d));
+				return makeRef(Tag::Float, offset);
+			}
+			case NodeType::String:
+				return writeStr(val->as<std::string_view>());
+			default:
+				return makeRef(Tag::Null, 0);
+			}
+		}
+		if (auto arr = std::get_if<ArrNode>(&node); arr) {
+			const auto& elems = arr->ccont();
+			uint64_t offset = alloc(sizeof(uint64_t) * (1 + elems.size()));
+			put(offset, elems.size());
+			for (size_t i = 0; i < elems.size(); ++i) {
+				// 'out' may grow while element is written - offsets stay valid
+				uint64_t ref = writeNode(elems[i]);
+				put(offset + sizeof(uint64_t) * (1 + i), ref);
+			}
+			return makeRef(Tag::Array, offset);
+		}
+		const auto& items = std::get<ObjNode>(node).ccont();
+		size_t count = items.size();
+		uint64_t offset = alloc(sizeof(uint64_t) * (1 + 2 * count) + sizeof(uint32_t) * count);
+		put(offset, count);
+		std::vector<std::string_view> keys;
+		keys.reserve(count);
+		size_t i = 0;
+		for (const auto& [key, elem] : items) {
+			keys.push_back(key.view());
+			uint64_t keyRef = writeStr(key.view());
+			uint64_t valRef = writeNode(elem);
+			put(offset + sizeof(uint64_t) * (1 + 2 * i), keyRef);
+			put(offset + sizeof(uint64_t) * (2 + 2 * i), valRef);
+			++i;
+		}
+		std::vector<uint32_t> sorted(count);
+		std::iota(sorted.begin(), sorted.end(), 0);
+		std::sort(sorted.begin(), sorted.end(), [&keys](uint32_t i1, uint32_t i2) { return keys[i1] < keys[i2]; });
+		if (count) {
+			std::memcpy(out.data() + offset + sizeof(uint64_t) * (1 + 2 * count), sorted.data(), sizeof(uint32_t) * count);
+		}
+		return makeRef(Tag::Object, offset);
+	}
+	std::string finish(uint64_t rootRef) {
+		std::memcpy(out.data(), Magic, sizeof(Magic));
+		put(8, ByteOrderMark);
+		put(16, out.size());
+		put(24, rootRef);
+		return std::move(out);
+	}
+private:
+	static constexpr int64_t SmallIntMax = (int64_t(1) << (TagShift - 1)) - 1;
+	static constexpr int64_t SmallIntMin = -SmallIntMax - 1;
+
+	// appends zeroed record of 'size' bytes (padded to 8) and returns its offset
+	inline uint64_t alloc(size_t size) {
+		uint64_t offset = out.size();
+		out.resize(offset + ((size + 7) & ~size_t(7)));
+		return offset;
+	}
+	inline void put(uint64_t offset, uint64_t w) {
+		std::memcpy(out.data() + offset, &w, sizeof(w));
+	}
+	uint64_t writeStr(std::string_view s) {
+		if (auto it = strings.find(s); it != strings.end()) {
+			return makeRef(Tag::String, it->second);
+		}
+		uint64_t offset = alloc(sizeof(uint64_t) + s.size());
+		put(offset, s.size());
+		std::memcpy(out.data() + offset + sizeof(uint64_t), s.data(), s.size());
+		strings.emplace(s, offset);
+		return makeRef(Tag::String, offset);
+	}
+	std::string out;
+	// offsets of written strings (views of nodes being written)
+	std::unordered_map<std::string_view, uint64_t> strings;
+};
+
+JsonImage::JsonImage() {
+
+}
+
+JsonImage::JsonImage(const std::string& path)
+	: file{ std::make_shared<MappedFile>(path, MappedFile::Access::Random) }, image{ file->view() }
+{
+	load();
+}
+
+JsonImage JsonImage::fromMemory(std::string_view image) {
+	JsonImage res;
+	res.image = image;
+	res.load();
+	return res;
+}
+
+std::string JsonImage::serialize(const Json& json) {
+	if (json.empty()) {
+		return {};
+	}
+	Writer writer;
+	uint64_t rootRef = writer.writeNode(json.get());
+	return writer.finish(rootRef);
+}
+
+void JsonImage::write(const Json& json, const std::string& path) {
+	std::string res = serialize(json);
+	std::ofstream os(path, std::ios::binary | std::ios::trunc);
+	os.write(res.data(), res.size());
+	if (!os) {
+		throw std::runtime_error("JSON image: couldn't write " + path);
+	}
+}
+
+void JsonImage::load() {
+	if (image.empty()) {
+		return;
+	}
+	if (image.size() < HeaderSize || std::memcmp(image.data(), Magic, sizeof(Magic)) != 0) {
+		throw std::runtime_error("JSON image: invalid header");
+	}
+	if (word(8) != ByteOrderMark) {
+		throw std::runtime_error("JSON image: byte order differs");
+	}
+	if (word(16) != image.size()) {
+		throw std::runtime_error("JSON image: size mismatch");
+	}
+	rootRef = word(24);
+}
+
+uint64_t JsonImage::word(uint64_t offset) const {
+	uint64_t res;
+	if (offset > image.size() || image.size() - offset < sizeof(res)) {
+		throw std::runtime_error("JSON image: offset out of bounds");
+	}
+	std::memcpy(&res, image.data() + offset, sizeof(res));
+	return res;
+}
+
+uint32_t JsonImage::word32(uint64_t offset) const {
+	uint32_t res;
+	if (offset > image.size() || image.size() - offset < sizeof(res)) {
+		throw std::runtime_error("JSON image: offset out of bounds");
+	}
+	std::memcpy(&res, image.data() + offset, sizeof(res));
+	return res;
+}
+
+std::string_view JsonImage::str(uint64_t offset) const {
+	uint64_t len = word(offset);
+	offset += sizeof(uint64_t);
+	if (len > image.size() - offset) {
+		throw std::runtime_error("JSON image: offset out of bounds");
+	}
+	return image.substr(offset, len);
+}
+
+bool JsonImage::empty() const {
+	return image.empty();
+}
+
+NodeType JsonImage::type() const {
+	return root().type();
+}
+
+std::vector<std::string> JsonImage::keys() const {
+	return root().keys();
+}
+
+std::vector<std::string> JsonImage::keys(const std::string& key) const {
+	return root().keys(key);
+}
+
+size_t JsonImage::arrSize() const {
+	return root().arrSize();
+}
+
+size_t JsonImage::arrSize(const std::string& key) const {
+	return root().arrSize(key);
+}
+
+ImageRef JsonImage::root() const {
+	return empty() ? ImageRef() : ImageRef(this, rootRef);
+}
+
+ImageRef JsonImage::get(const std::string& key) const {
+	return root().get(key);
+}
+
+ImageRef JsonImage::get(std::span<const PathSegment> path) const {
+	return root().get(path);
+}
+
+ImageRef::ImageRef() {
+
+}
+
+ImageRef::ImageRef(const JsonImage* doc, uint64_t ref)
+	: doc{ doc }, ref{ ref }
+{
+
+}
+
+bool ImageRef::empty() const {
+	return doc == nullptr;
+}
+
+NodeType ImageRef::type() const {
+	if (empty()) {
+		return NodeType::NoType;
+	}
+	switch (JsonImage::tagOf(ref)) {
+	case JsonImage::Tag::Object:
+		return NodeType::Object;
+	case JsonImage::Tag::Array:
+		return NodeType::Array;
+	case JsonImage::Tag::String:
+		return NodeType::String;
+	case JsonImage::Tag::SmallInt:
+	case JsonImage::Tag::Int:
+		return NodeType::Int;
+	case JsonImage::Tag::Float:
+		return NodeType::Float;
+	case JsonImage::Tag::True:
+	case JsonImage::Tag::False:
+		return NodeType::Bool;
+	case JsonImage::Tag::Null:
+		return NodeType::Null;
+	default:
+		return NodeType::NoType;
+	}
+}
+
+std::vector<std::string> ImageRef::keys() const {
+	if (type() != NodeType::Object) {
+		throw std::logic_error("JSON: not an object node");
+	}
+	uint64_t offset = JsonImage::payloadOf(ref);
+	uint64_t count = doc->word(offset);
+	std::vector<std::string> res;
+	res.reserve(count);
+	for (uint64_t i = 0; i < count; ++i) {
+		res.emplace_back(doc->str(JsonImage::payloadOf(doc->word(offset + sizeof(uint64_t) * (1 + 2 * i)))));
+	}
+	return res;
+}
+
+std::vector<std::string> ImageRef::keys(const std::string& key) const {
+	return get(key).keys();
+}
+
+size_t ImageRef::arrSize() const {
+	if (type() != NodeType::Array) {
+		throw std::logic_error("JSON: not an array node");
+	}
+	return doc->word(JsonImage::payloadOf(ref));
+}
+
+size_t ImageRef::arrSize(const std::string& key) const {
+	return get(key).arrSize();
+}
+
+ImageRef ImageRef::get(const std::string& key) const {
+	return get(split(key, "."));
+}
+
+ImageRef ImageRef::get(std::span<const PathSegment> path) const {
+	ImageRef cur = *this;
+	for (const auto& seg : path) {
+		NodeType t = cur.type();
+		if (t == NodeType::Object) {
+			cur = cur.objChild(seg.key);
+		}
+		else if (t == NodeType::Array && seg.idx) {
+			cur = cur.arrChild(*seg.idx);
+		}
+		else {
+			throw std::out_of_range("couldn't get node");
+		}
+	}
+	return cur;
+}
+
+ImageRef ImageRef::child(std::string_view key) const {
+	NodeType t = type();
+	if (t == NodeType::Object) {
+		return objChild(key);
+	}
+	else if (t == NodeType::Array) {
+		if (auto n = utils::getIdx(key); n) {
+			return arrChild(*n);
+		}
+	}
+	throw std::out_of_range("couldn't get node");
+}
+
+ImageRef ImageRef::objChild(std::string_view key) const {
+	uint64_t offset = JsonImage::payloadOf(ref);
+	uint64_t count = doc->word(offset);
+	uint64_t sortedOffset = offset + sizeof(uint64_t) * (1 + 2 * count);
+	uint64_t lo = 0, hi = count;
+	while (lo < hi) {
+		uint64_t mid = lo + (hi - lo) / 2;
+		uint64_t member = offset + sizeof(uint64_t) * (1 + 2 * uint64_t(doc->word32(sortedOffset + sizeof(uint32_t) * mid)));
+		int cmp = doc->str(JsonImage::payloadOf(doc->word(member))).compare(key);
+		if (cmp == 0) {
+			return ImageRef(doc, doc->word(member + sizeof(uint64_t)));
+		}
+		if (cmp < 0) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	throw std::out_of_range("couldn't get node");
+}
+
+ImageRef ImageRef::arrChild(size_t idx) const {
+	uint64_t offset = JsonImage::payloadOf(ref);
+	if (idx >= doc->word(offset)) {
+		throw std::out_of_range("couldn't get node");
+	}
+	return ImageRef(doc, doc->word(offset + sizeof(uint64_t) * (1 + idx)));
+}
+
+// type mismatches throw the same exception as Json
+int64_t ImageRef::asInt() const {
+	if (type() != NodeType::Int) {
+		throw std::bad_variant_access();
+	}
+	uint64_t payload = JsonImage::payloadOf(ref);
+	if (JsonImage::tagOf(ref) == JsonImage::Tag::SmallInt) {
+		// sign extension of 56 bits
+		return static_cast<int64_t>(payload << (64 - JsonImage::TagShift)) >> (64 - JsonImage::TagShift);
+	}
+	return static_cast<int64_t>(doc->word(payload));
+}
+
+double ImageRef::asFloat() const {
+	if (type() != NodeType::Float) {
+		throw std::bad_variant_access();
+	}
+	uint64_t w = doc->word(JsonImage::payloadOf(ref));
+	double res;
+	std::memcpy(&res, &w, sizeof(res));
+	return res;
+}
+
+bool ImageRef::asBool() const {
+	if (type() != NodeType::Bool) {
+		throw std::bad_variant_access();
+	}
+	return JsonImage::tagOf(ref) == JsonImage::Tag::True;
+}
+
+std::string_view ImageRef::asStr() const {
+	if (type() != NodeType::String) {
+		throw std::bad_variant_access();
+	}
+	return doc->str(JsonImage::payloadOf(ref));
+}
@@ -0,0 +1,259 @@
+#pragma once
+#include <span>
+#include "Json.hpp"
+#include "MappedFile.hpp"
+
+namespace util::web::json {
+
+	class JsonImage;
+
+	// reference to a value inside JsonImage (valid while image is alive).
+	// Has the same read-only interface as Json and TapeRef
+	class ImageRef {
+	public:
+		ImageRef();
+
+		// strings can be read as std::string_view into image
+		template<typename T>
+		T as() const;
+		template<typename T>
+		T as(const std::string& key) const;
+		template<typename T, StringVector Cont>
+		T as(const Cont& keys) const;
+		// compiled path (JsonPath or jsonPath<"...">) - lookup makes no allocations
+		template<typename T>
+		T as(std::span<const PathSegment> path) const;
+
+		bool empty() const;
+		NodeType type() const;
+
+		// in document order
+		std::vector<std::string> keys() const;
+		std::vector<std::string> keys(const std::string& key) const;
+		template<StringVector Cont>
+		std::vector<std::string> keys(const Cont& keys) const;
+
+		size_t arrSize() const;
+		size_t arrSize(const std::string& key) const;
+		template<StringVector Cont>
+		size_t arrSize(const Cont& keys) const;
+
+		// same path syntax as Json::get(): '.' delimiter and '[]' indexes
+		ImageRef get(const std::string& key) const;
+		template<StringVector Cont>
+		ImageRef get(const Cont& keys) const;
+		ImageRef get(std::span<const PathSegment> path) const;
+	private:
+		friend class JsonImage;
+		ImageRef(const JsonImage* doc, uint64_t ref);
+		ImageRef child(std::string_view key) const;
+		// binary search in sorted keys
+		ImageRef objChild(std::string_view key) const;
+		ImageRef arrChild(size_t idx) const;
+		int64_t asInt() const;
+		double asFloat() const;
+		bool asBool() const;
+		std::string_view asStr() const;
+
+		const JsonImage* doc = nullptr;
+		// reference word of value (see JsonImage)
+		uint64_t ref = 0;
+	};
+
+	// persisted read-only document: Json serialized by write() is loaded by mapping the file (MappedFile), and
+	// values are read right from mapped bytes - nothing is parsed or allocated on load, so large reference datasets
+	// are available at once, and processes mapping the same file share its pages.
+	// Image is a header and 8-byte aligned records. Value is referenced by 64-bit word: tag (high byte) + payload,
+	// which is either the value itself (null, bools, integers fitting 56 bits) or offset of its record:
+	// 8-byte number, string (length + bytes), array (count + references of elements, so indexing is O(1)),
+	// object (count + key and value references in document order + positions of members sorted by key,
+	// so members are found by binary search). Equal strings are stored once.
+	// Images are written in native byte order; loading image of other byte order throws
+	class JsonImage {
+	public:
+		enum class Tag : uint8_t {
+			Object = '{',
+			Array = '[',
+			String = '"',
+			// payload is the value
+			SmallInt = 'i',
+			Int = 'l',
+			Float = 'd',
+			True = 't',
+			False = 'f',
+			Null = 'n'
+		};
+
+		JsonImage();
+		// maps file written by write(); throws std::runtime_error if it isn't an image
+		explicit JsonImage(const std::string& path);
+		// image in memory, which should outlive result and be 8-byte aligned
+		static JsonImage fromMemory(std::string_view image);
+
+		// image of 'json'
+		static std::string serialize(const Json& json);
+		static void write(const Json& json, const std::string& path);
+
+		template<typename T>
+		T as() const;
+		template<typename T>
+		T as(const std::string& key) const;
+		template<typename T, StringVector Cont>
+		T as(const Cont& keys) const;
+		template<typename T>
+		T as(std::span<const PathSegment> path) const;
+
+		bool empty() const;
+		NodeType type() const;
+
+		std::vector<std::string> keys() const;
+		std::vector<std::string> keys(const std::string& key) const;
+		template<StringVector Cont>
+		std::vector<std::string> keys(const Cont& keys) const;
+
+		size_t arrSize() const;
+		size_t arrSize(const std::string& key) const;
+		template<StringVector Cont>
+		size_t arrSize(const Cont& keys) const;
+
+		ImageRef root() const;
+		ImageRef get(const std::string& key) const;
+		template<StringVector Cont>
+		ImageRef get(const Cont& keys) const;
+		ImageRef get(std::span<const PathSegment> path) const;
+
+		// bytes of image
+		inline std::string_view bytes() const { return image; }
+	private:
+		friend class ImageRef;
+		class Writer;
+
+		static constexpr int TagShift = 56;
+		static constexpr uint64_t PayloadMask = (uint64_t(1) << TagShift) - 1;
+		// "JSONIMG" and version
+		static constexpr char Magic[8] = { 'J', 'S', 'O', 'N', 'I', 'M', 'G', '1' };
+		// written in native order - detects images of other byte order
+		static constexpr uint64_t ByteOrderMark = 0x0102030405060708ULL;
+		// magic, byte order mark, size of image, reference of root
+		static constexpr size_t HeaderSize = 32;
+
+		static inline Tag tagOf(uint64_t ref) { return static_cast<Tag>(ref >> TagShift); }
+		static inline uint64_t payloadOf(uint64_t ref) { return ref & PayloadMask; }
+		static inline uint64_t makeRef(Tag tag, uint64_t payload) { return (uint64_t(tag) << TagShift) | (payload & PayloadMask); }
+
+		void load();
+		// 8-byte word at 'offset'; throws if it is outside of image
+		uint64_t word(uint64_t offset) const;
+		uint32_t word32(uint64_t offset) const;
+		std::string_view str(uint64_t offset) const;
+
+		// keeps mapping alive
+		std::shared_ptr<MappedFile> file;
+		std::string_view image;
+		uint64_t rootRef = 0;
+	};
+
+	template<typename T>
+	T ImageRef::as() const {
+		if constexpr (std::is_same_v<T, bool>) {
+			return asBool();
+		}
+		else if constexpr (std::is_same_v<T, Null>) {
+			if (type() != NodeType::Null) {
+				throw std::bad_variant_access();
+			}
+			return Null{};
+		}
+		else if constexpr (ValueStringType<T>) {
+			return T(asStr());
+		}
+		else if constexpr (std::is_integral_v<T>) {
+			return static_cast<T>(asInt());
+		}
+		else if constexpr (std::is_floating_point_v<T>) {
+			return static_cast<T>(asFloat());
+		}
+		else {
+			size_t size = arrSize();
+			T res;
+			res.reserve(size);
+			for (size_t i = 0; i < size; ++i) {
+				res.push_back(arrChild(i).as<typename T::value_type>());
+			}
+			return res;
+		}
+	}
+
+	template<typename T>
+	T ImageRef::as(const std::string& key) const {
+		ImageRef node = get(key);
+		return node.as<T>();
+	}
+
+	template<typename T, StringVector Cont>
+	T ImageRef::as(const Cont& keys) const {
+		ImageRef node = get(keys);
+		return node.as<T>();
+	}
+
+	template<typename T>
+	T ImageRef::as(std::span<const PathSegment> path) const {
+		ImageRef node = get(path);
+		return node.as<T>();
+	}
+
+	template<StringVector Cont>
+	std::vector<std::string> ImageRef::keys(const Cont& keys) const {
+		return get(keys).keys();
+	}
+
+	template<StringVector Cont>
+	size_t ImageRef::arrSize(const Cont& keys) const {
+		return get(keys).arrSize();
+	}
+
+	template<StringVector Cont>
+	ImageRef ImageRef::get(const Cont& keys) const {
+		ImageRef cur = *this;
+		for (const auto& key : keys) {
+			cur = cur.child(std::string_view(key.data(), key.size()));
+		}
+		return cur;
+	}
+
+	template<typename T>
+	T JsonImage::as() const {
+		return root().as<T>();
+	}
+
+	template<typename T>
+	T JsonImage::as(const std::string& key) const {
+		return root().as<T>(key);
+	}
+
+	template<typename T, StringVector Cont>
+	T JsonImage::as(const Cont& keys) const {
+		return root().as<T>(keys);
+	}
+
+	template<typename T>
+	T JsonImage::as(std::span<const PathSegment> path) const {
+		return root().as<T>(path);
+	}
+
+	template<StringVector Cont>
+	std::vector<std::string> JsonImage::keys(const Cont& keys) const {
+		return root().keys(keys);
+	}
+
+	template<StringVector Cont>
+	size_t JsonImage::arrSize(const Cont& keys) const {
+		return root().arrSize(keys);
+	}
+
+	template<StringVector Cont>
+	ImageRef JsonImage::get(const Cont& keys) const {
+		return root().get(keys);
+	}
+
+}
@@ -0,0 +1,176 @@
+#include "JsonNdjson.hpp"
+#include "MappedFile.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <format>
+
+using namespace util::web::json;
+
+namespace {
+
+	struct Batch {
+		explicit Batch(std::string_view text)
+			: text{ text }
+		{
+
+		}
+		std::string_view text;
+		std::vector<Json> records;
+		// lines in text, including empty ones
+		size_t lines = 0;
+		std::exception_ptr error;
+		// line of error inside batch
+		size_t errorLine = 0;
+		bool ready = false;
+	};
+
+	// splits 'v' into pieces of about 'batchSize' bytes, ending right after '\n'
+	std::vector<Batch> makeBatches(std::string_view v, size_t batchSize) {
+		std::vector<Batch> res;
+		size_t pos = 0;
+		while (pos < v.size()) {
+			size_t end = std::min(v.size(), pos + std::max<size_t>(batchSize, 1));
+			if (end < v.size()) {
+				const void* nl = std::memchr(v.data() + end, '\n', v.size() - end);
+				end = nl ? static_cast<const char*>(nl) - v.data() + 1 : v.size();
+			}
+			res.emplace_back(v.substr(pos, end - pos));
+			pos = end;
+		}
+		return res;
+	}
+
+	void decodeBatch(Batch& batch, JsonDecoder& decoder, const std::shared_ptr<const void>& source) {
+		std::string_view v = batch.text;
+		size_t pos = 0;
+		while (pos < v.size()) {
+			const void* nl = std::memchr(v.data() + pos, '\n', v.size() - pos);
+			size_t end = nl ? static_cast<const char*>(nl) - v.data() : v.size();
+			std::string_view line = v.substr(pos, end - pos);
+			++batch.lines;
+			pos = end + 1;
+			if (utils::skipSpaces(line, 0) == line.size()) {
+				continue;
+			}
+			try {
+				batch.records.push_back(source ? decoder.decode(line, source) : decoder.decode(line));
+			}
+			catch (...) {
+				batch.error = std::current_exception();
+				batch.errorLine = batch.lines;
+				return;
+			}
+		}
+	}
+
+}
+
+NdjsonDecoder::NdjsonDecoder() {
+
+}
+
+NdjsonDecoder::NdjsonDecoder(const Opts& opts)
+	: opts{ opts }
+{
+
+}
+
+size_t NdjsonDecoder::decode(std::string_view v, const Callback& f) {
+	return decodeImpl(v, nullptr, f);
+}
+
+size_t NdjsonDecoder::decodeFile(const std::string& path, const Callback& f) {
+	auto file = std::make_shared<MappedFile>(path);
+	return decodeImpl(file->view(), opts.borrowStrings ? file : nullptr, f);
+}
+
+size_t NdjsonDecoder::decodeImpl(std::string_view v, const std::shared_ptr<const void>& source, const Callback& f) {
+	std::vector<Batch> batches = makeBatches(v, opts.batchSize);
+	size_t threads = opts.threads ? opts.threads : std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, batches.size());
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	size_t next = 0;
+	size_t delivered = 0;
+	bool stop = false;
+	// workers don't run too far ahead of delivery, so decoded records don't pile up in memory
+	const size_t window = threads * 4;
+	std::vector<std::jthread> workers;
+	auto stopWorkers = [&]() {
+		{
+			std::lock_guard lock(mutex);
+			stop = true;
+		}
+		cv.notify_all();
+		// joins
+		workers.clear();
+	};
+
+	size_t res = 0;
+	size_t line = 0;
+	try {
+		// single thread - no synchronization needed, batches are decoded in place right before delivery
+		std::optional<JsonDecoder> decoder;
+		if (threads <= 1) {
+			decoder.emplace(opts.decoder);
+		}
+		else {
+			for (size_t i = 0; i < threads; ++i) {
+				workers.emplace_back([&]() {
+					JsonDecoder decoder(opts.decoder);
+					std::unique_lock lock(mutex);
+					for (;;) {
+						cv.wait(lock, [&]() { return stop || next >= batches.size() || next < delivered + window; });
+						if (stop || next >= batches.size()) {
+							return;
+						}
+						Batch& batch = batches[next++];
+						lock.unlock();
+						decodeBatch(batch, decoder, source);
+						lock.lock();
+						batch.ready = true;
+						cv.notify_all();
+					}
+				});
+			}
+		}
+		for (auto& batch : batches) {
+			if (decoder) {
+				decodeBatch(batch, *decoder, source);
+			}
+			else {
+				std::unique_lock lock(mutex);
+				cv.wait(lock, [&]() { return batch.ready; });
+			}
+			for (auto& record : batch.records) {
+				f(std::move(record));
+			}
+			res += batch.records.size();
+			if (batch.error) {
+				try {
+					std::rethrow_exception(batch.error);
+				}
+				catch (const std::exception& e) {
+					throw std::runtime_error(std::format("NDJSON: invalid record at line {}: {}", line + batch.errorLine, e.what()));
+				}
+			}
+			line += batch.lines;
+			// memory of delivered records
+			batch.records = std::vector<Json>();
+			{
+				std::lock_guard lock(mutex);
+				++delivered;
+			}
+			cv.notify_all();
+		}
+	}
+	catch (...) {
+		stopWorkers();
+		throw;
+	}
+	stopWorkers();
+	return res;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <functional>
+#include "Json.hpp"
+
+namespace util::web::json {
+
+	// decoder of newline-delimited json (one document per line, f.e. logs).
+	// Input is cut into batches on line boundaries, batches are decoded by worker threads,
+	// and records are delivered to callback in input order, from calling thread
+	class NdjsonDecoder {
+	public:
+		struct Opts {
+			// worker threads; 0 - number of cores
+			size_t threads = 0;
+			// approximate size of input decoded by one task
+			size_t batchSize = 256 * 1024;
+			// strings of records borrow memory of mapped file (decodeFile() only); records keep mapping alive
+			bool borrowStrings = false;
+			JsonDecoder::Opts decoder = {};
+		};
+		using Callback = std::function<void(Json&& record)>;
+
+		NdjsonDecoder();
+		NdjsonDecoder(const Opts& opts);
+		// empty lines are skipped. On invalid record records before it are delivered, then std::runtime_error
+		// with line number is thrown. Returns number of records
+		size_t decode(std::string_view v, const Callback& f);
+		// file is memory-mapped instead of being read
+		size_t decodeFile(const std::string& path, const Callback& f);
+	private:
+		size_t decodeImpl(std::string_view v, const std::shared_ptr<const void>& source, const Callback& f);
+		Opts opts;
+	};
+
+}
@@ -0,0 +1,441 @@
+#pragma once
+#include "Json.hpp"
+#include "JsonSimd.hpp"
+#include <tuple>
+#include <array>
+#include <bit>
+#include <ranges>
+#include <cstring>
+#include <charconv>
+#include <utility>
+
+namespace util::web::json {
+
+	// member of reflected struct: json key and pointer to member
+	template<typename T, typename M>
+	struct Field {
+		std::string_view name;
+		M T::* ptr;
+	};
+
+	template<typename T, typename M>
+	constexpr Field<T, M> field(std::string_view name, M T::* ptr) {
+		return { name, ptr };
+	}
+
+	// key is the name of member
+#define JSON_FIELD(Type, member) ::util::web::json::field(#member, &Type::member)
+
+	// struct is reflected by static member function returning tuple of fields:
+	//	struct Point {
+	//		double x, y;
+	//		static constexpr auto jsonFields() { return std::make_tuple(JSON_FIELD(Point, x), JSON_FIELD(Point, y)); }
+	//	};
+	// or, for types which can't be changed, by specialization with static get() returning the same tuple
+	template<typename T>
+	struct JsonFields;
+
+	template<typename T>
+	concept Reflected = requires { T::jsonFields(); } || requires { JsonFields<T>::get(); };
+
+	// supported members: bool, integral and floating point types, std::string, std::optional (null if empty),
+	// ranges with emplace_back (f.e. std::vector) and reflected structs. Other members of struct are ignored.
+	// 'val' is a reflected struct or range of them
+	template<typename T>
+	void encodeStruct(const T& val, std::string& out);
+	template<typename T>
+	std::string encodeStruct(const T& val);
+
+	// decodes text straight into 'val' without building nodes. Keys are matched by compile-time perfect hash,
+	// members missing in text keep their values. Unknown keys are skipped without validation of their values (as in JsonView).
+	// Throws std::runtime_error on invalid json or value of wrong type
+	template<typename T>
+	void decodeStruct(std::string_view v, T& val);
+	template<typename T>
+	T decodeStruct(std::string_view v);
+
+	namespace reflect {
+
+		template<typename T>
+		constexpr auto fieldsOf() {
+			if constexpr (requires { T::jsonFields(); }) {
+				return T::jsonFields();
+			}
+			else {
+				return JsonFields<T>::get();
+			}
+		}
+
+		template<typename T>
+		struct IsOptional : std::false_type {};
+		template<typename T>
+		struct IsOptional<std::optional<T>> : std::true_type {};
+
+		template<typename T>
+		concept Sequence = std::ranges::range<T> && requires(T cont) {
+			cont.emplace_back();
+			cont.clear();
+		};
+
+		template<typename T>
+		inline constexpr bool Unsupported = false;
+
+		constexpr uint64_t keyHash(std::string_view key, uint64_t seed) {
+			// fnv-1a with final mixing
+			uint64_t h = 0xcbf29ce484222325ULL;
+			for (char ch : key) {
+				h = (h ^ static_cast<unsigned char>(ch)) * 0x100000001b3ULL;
+			}
+			h = (h ^ seed) * 0x9E3779B97F4A7C15ULL;
+			return h ^ (h >> 29);
+		}
+
+		// collision-free table of field names: key is compared with the only candidate
+		template<typename T>
+		struct FieldIndex {
+			static constexpr auto Fields = fieldsOf<T>();
+			static constexpr size_t Count = std::tuple_size_v<decltype(Fields)>;
+			static constexpr auto Names = std::apply([](const auto&... f) { return std::array<std::string_view, Count>{ f.name... }; }, Fields);
+			// load factor of 1/4 - seed is found in a few attempts
+			static constexpr size_t TableSize = std::bit_ceil(Count * 4 + 1);
+			static constexpr size_t NoSeed = ~size_t(0);
+
+			static constexpr size_t findSeed() {
+				for (size_t seed = 0; seed < 100000; ++seed) {
+					std::array<bool, TableSize> used{};
+					bool ok = true;
+					for (auto name : Names) {
+						size_t idx = keyHash(name, seed) & (TableSize - 1);
+						if (used[idx]) {
+							ok = false;
+							break;
+						}
+						used[idx] = true;
+					}
+					if (ok) {
+						return seed;
+					}
+				}
+				return NoSeed;
+			}
+			static constexpr size_t Seed = findSeed();
+			static_assert(Seed != NoSeed, "JSON: duplicate field names");
+
+			// field number + 1, 0 for empty slots
+			static constexpr auto Table = []() {
+				std::array<uint8_t, TableSize> res{};
+				for (size_t i = 0; i < Count; ++i) {
+					res[keyHash(Names[i], Seed) & (TableSize - 1)] = static_cast<uint8_t>(i + 1);
+				}
+				return res;
+			}();
+			static_assert(Count < 255, "JSON: too many fields");
+
+			static constexpr bool validNames() {
+				for (auto name : Names) {
+					for (char ch : name) {
+						if (ch == '"' || ch == '\\' || static_cast<unsigned char>(ch) < 0x20) {
+							return false;
+						}
+					}
+				}
+				return true;
+			}
+			static_assert(validNames(), "JSON: field names are written without escaping");
+
+			// number of field or Count
+			static inline size_t find(std::string_view key) {
+				uint8_t slot = Table[keyHash(key, Seed) & (TableSize - 1)];
+				if (slot && Names[slot - 1] == key) {
+					return slot - 1;
+				}
+				return Count;
+			}
+		};
+
+		template<typename T>
+		void encodeValue(const T& val, std::string& out);
+
+		template<typename T>
+		void encodeObj(const T& val, std::string& out) {
+			out.push_back('{');
+			size_t i = 0;
+			std::apply([&](const auto&... f) {
+				((out.append(i++ ? ",\"" : "\"").append(f.name).append("\":", 2), encodeValue(val.*(f.ptr), out)), ...);
+			}, FieldIndex<T>::Fields);
+			out.push_back('}');
+		}
+
+		template<typename T>
+		void encodeValue(const T& val, std::string& out) {
+			if constexpr (std::is_same_v<T, bool>) {
+				out.append(val ? "true" : "false");
+			}
+			else if constexpr (std::is_unsigned_v<T>) {
+				// values above INT64_MAX
+				char buf[24];
+				auto res = std::to_chars(buf, buf + sizeof(buf), val);
+				out.append(buf, res.ptr);
+			}
+			else if constexpr (std::is_integral_v<T>) {
+				utils::appendInt(out, static_cast<int64_t>(val));
+			}
+			else if constexpr (std::is_floating_point_v<T>) {
+				utils::appendFloat(out, static_cast<double>(val));
+			}
+			else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+				out.push_back('"');
+				simd::escapeStr(val, out);
+				out.push_back('"');
+			}
+			else if constexpr (IsOptional<T>::value) {
+				if (val) {
+					encodeValue(*val, out);
+				}
+				else {
+					out.append("null");
+				}
+			}
+			else if constexpr (Reflected<T>) {
+				encodeObj(val, out);
+			}
+			else if constexpr (std::ranges::range<T>) {
+				out.push_back('[');
+				bool first = true;
+				for (const auto& elem : val) {
+					if (!first) {
+						out.push_back(',');
+					}
+					first = false;
+					encodeValue(elem, out);
+				}
+				out.push_back(']');
+			}
+			else {
+				static_assert(Unsupported<T>, "JSON: unsupported member type");
+			}
+		}
+
+		// typed reader over json text: values are parsed right into members
+		class StructReader {
+		public:
+			StructReader(std::string_view v)
+				: v{ v }
+			{
+
+			}
+			template<typename T>
+			void read(T& val);
+			// only spaces may follow
+			inline void finish() {
+				if (peek() != '\0') {
+					throw std::runtime_error("JSON: unexpected characters after root node");
+				}
+			}
+		private:
+			template<typename T>
+			void readObj(T& val);
+			template<typename T>
+			void readArr(T& val);
+			// skips spaces and returns current character ('\0' if input is over)
+			inline char peek() {
+				pos = utils::skipSpaces(v, pos);
+				return pos < v.size() ? v[pos] : '\0';
+			}
+			inline void expect(char ch, const char* error) {
+				if (peek() != ch) {
+					throw std::runtime_error(error);
+				}
+				++pos;
+			}
+			inline void readLiteral(std::string_view literal, const char* error) {
+				if (v.substr(pos, literal.size()) != literal) {
+					throw std::runtime_error(error);
+				}
+				pos += literal.size();
+			}
+			// returns unescaped string, which is either part of text or kept in 'buf'
+			inline std::string_view readStr(std::string& buf) {
+				expect('"', "invalid string node");
+				size_t end = utils::findStrEnd(v, pos);
+				if (end == v.npos) {
+					throw std::runtime_error("invalid string node");
+				}
+				std::string_view raw = v.substr(pos, end - pos);
+				pos = end + 1;
+				size_t esc = simd::findEscape(raw);
+				if (esc == raw.npos) {
+					return raw;
+				}
+				buf.resize(raw.size());
+				std::memcpy(buf.data(), raw.data(), esc);
+				buf.resize(esc + simd::unescapeStr(raw.substr(esc), buf.data() + esc));
+				return buf;
+			}
+			inline void skipValue() {
+				peek();
+				pos = utils::skipValue(v, pos);
+			}
+			std::string_view v;
+			size_t pos = 0;
+			// unescaped keys
+			std::string key;
+		};
+
+		template<typename T>
+		void StructReader::read(T& val) {
+			char ch = peek();
+			if constexpr (std::is_same_v<T, bool>) {
+				if (ch == 't') {
+					readLiteral("true", "invalid bool node");
+					val = true;
+				}
+				else {
+					readLiteral("false", "invalid bool node");
+					val = false;
+				}
+			}
+			else if constexpr (std::is_integral_v<T>) {
+				if (!check::isNumberStart(ch)) {
+					throw std::runtime_error("invalid int node");
+				}
+				size_t start = pos;
+				auto num = utils::parseNumber(v, pos);
+				if (std::holds_alternative<int64_t>(num)) {
+					// no wrapping to range of T
+					if (!std::in_range<T>(std::get<int64_t>(num))) {
+						throw std::runtime_error("invalid int node");
+					}
+					val = static_cast<T>(std::get<int64_t>(num));
+				}
+				else if constexpr (std::is_unsigned_v<T> && sizeof(T) == sizeof(uint64_t)) {
+					// integers above INT64_MAX are parsed as doubles
+					if (auto res = std::from_chars(v.data() + start, v.data() + pos, val); res.ec != std::errc{} || res.ptr != v.data() + pos) {
+						throw std::runtime_error("invalid int node");
+					}
+				}
+				else {
+					throw std::runtime_error("invalid int node");
+				}
+			}
+			else if constexpr (std::is_floating_point_v<T>) {
+				if (!check::isNumberStart(ch)) {
+					throw std::runtime_error("invalid float node");
+				}
+				auto num = utils::parseNumber(v, pos);
+				val = static_cast<T>(std::holds_alternative<int64_t>(num) ? static_cast<double>(std::get<int64_t>(num)) : std::get<double>(num));
+			}
+			else if constexpr (std::is_same_v<T, std::string>) {
+				std::string_view s = readStr(val);
+				// not unescaped into 'val' already
+				if (s.data() != val.data()) {
+					val.assign(s);
+				}
+			}
+			else if constexpr (IsOptional<T>::value) {
+				if (ch == 'n') {
+					readLiteral("null", "invalid null node");
+					val.reset();
+				}
+				else {
+					read(val.emplace());
+				}
+			}
+			else if constexpr (Reflected<T>) {
+				readObj(val);
+			}
+			else if constexpr (Sequence<T>) {
+				readArr(val);
+			}
+			else {
+				static_assert(Unsupported<T>, "JSON: unsupported member type");
+			}
+		}
+
+		template<typename T>
+		void StructReader::readObj(T& val) {
+			using Index = FieldIndex<T>;
+			using Reader = void(*)(StructReader&, T&);
+			// readers of fields by their numbers
+			static constexpr auto Readers = []<size_t... I>(std::index_sequence<I...>) {
+				return std::array<Reader, Index::Count>{ [](StructReader& r, T& obj) { r.read(obj.*(std::get<I>(Index::Fields).ptr)); }... };
+			}(std::make_index_sequence<Index::Count>());
+
+			expect('{', "invalid object node");
+			if (peek() == '}') {
+				++pos;
+				return;
+			}
+			for (;;) {
+				if (peek() != '"') {
+					throw std::runtime_error("invalid object node");
+				}
+				size_t idx = Index::find(readStr(key));
+				expect(':', "invalid object node");
+				if (idx < Index::Count) {
+					Readers[idx](*this, val);
+				}
+				else {
+					skipValue();
+				}
+				char ch = peek();
+				++pos;
+				if (ch == '}') {
+					break;
+				}
+				else if (ch != ',') {
+					throw std::runtime_error("invalid object node");
+				}
+			}
+		}
+
+		template<typename T>
+		void StructReader::readArr(T& val) {
+			expect('[', "invalid array node");
+			val.clear();
+			if (peek() == ']') {
+				++pos;
+				return;
+			}
+			for (;;) {
+				read(val.emplace_back());
+				char ch = peek();
+				++pos;
+				if (ch == ']') {
+					break;
+				}
+				else if (ch != ',') {
+					throw std::runtime_error("invalid array node");
+				}
+			}
+		}
+
+	}
+
+	template<typename T>
+	void encodeStruct(const T& val, std::string& out) {
+		reflect::encodeValue(val, out);
+	}
+
+	template<typename T>
+	std::string encodeStruct(const T& val) {
+		std::string res;
+		encodeStruct(val, res);
+		return res;
+	}
+
+	template<typename T>
+	void decodeStruct(std::string_view v, T& val) {
+		reflect::StructReader reader(v);
+		reader.read(val);
+		reader.finish();
+	}
+
+	template<typename T>
+	T decodeStruct(std::string_view v) {
+		T res{};
+		decodeStruct(v, res);
+		return res;
+	}
+
+}
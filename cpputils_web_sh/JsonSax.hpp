@@ -0,0 +1,356 @@
+#pragma once
+#include "Json.hpp"
+#include "JsonSimd.hpp"
+#include <format>
+#include <cstring>
+
+namespace util::web::json {
+
+	// receiver of parsing events. Strings and keys are raw (escape sequences are kept, see simd::unescapeStr())
+	// and point into parsed text.
+	// Handler is a template parameter of SaxParser, so calls are resolved at compile time and can be inlined
+	template<typename H>
+	concept SaxHandler = requires(H h, std::string_view s, int64_t i, double d, bool b) {
+		h.onStartObject();
+		h.onKey(s);
+		h.onEndObject();
+		h.onStartArray();
+		h.onEndArray();
+		h.onString(s);
+		h.onInt(i);
+		h.onDouble(d);
+		h.onBool(b);
+		h.onNull();
+	};
+
+	// handler ignoring all events - derive from it and hide only needed ones
+	struct SaxHandlerBase {
+		inline void onStartObject() {}
+		inline void onKey(std::string_view) {}
+		inline void onEndObject() {}
+		inline void onStartArray() {}
+		inline void onEndArray() {}
+		inline void onString(std::string_view) {}
+		inline void onInt(int64_t) {}
+		inline void onDouble(double) {}
+		inline void onBool(bool) {}
+		inline void onNull() {}
+	};
+
+	// single pass over json text, calling handler for every value; nothing is allocated per value
+	template<SaxHandler Handler>
+	class SaxParser {
+	public:
+		// structuralIndex - find strings' ends with vectorized structural index (JsonSimd.hpp) instead of scanning them
+		SaxParser(Handler& handler, bool structuralIndex = true);
+		// throws std::runtime_error/std::logic_error on invalid json. Events before error have already been delivered
+		void parse(std::string_view v);
+		// parses part of container (used by parallel decoding): members following 'start' - elements of array,
+		// or keys and values of object if 'object'. Stops at closing bracket, or at ',' after member ending at or after 'stop'.
+		// Handler doesn't get start and end of container. Returns position of that bracket or ','
+		size_t parseMembers(std::string_view v, size_t start, size_t stop, bool object);
+	private:
+		// every parse* method consumes its value and leaves cursor right after it
+		struct Cursor {
+			std::string_view v;
+			size_t pos = 0;
+			// optional structural index of 'v', used to find string ends without scanning
+			const uint32_t* idx = nullptr;
+			const uint32_t* idxEnd = nullptr;
+			inline bool atEnd() const { return pos >= v.size(); }
+			// position of first structural character at or after 'from'
+			inline size_t nextStructural(size_t from) {
+				while (idx < idxEnd && *idx < from) {
+					++idx;
+				}
+				return idx < idxEnd ? *idx : v.npos;
+			}
+			// skips spaces and returns current character ('\0' if input is over)
+			inline char peek() {
+				pos = utils::skipSpaces(v, pos);
+				return atEnd() ? '\0' : v[pos];
+			}
+			inline void expect(char ch) {
+				if (peek() != ch) {
+					throw std::runtime_error(std::format("JSON: expected '{}' at position {}", ch, pos));
+				}
+				++pos;
+			}
+		};
+		void buildIndex(std::string_view v, size_t offset);
+		void parseValue();
+		void parseObj();
+		void parseArr();
+		void parseNumber();
+		void parseLiteral(std::string_view literal);
+		// returns string contents without quotes
+		std::string_view parseRawStr();
+		// building index for small inputs costs more than it saves
+		static constexpr size_t IndexMinSize = 256;
+		Handler& handler;
+		bool structuralIndex;
+		Cursor cur;
+		// kept between parse() calls to reuse memory
+		std::vector<uint32_t> index;
+	};
+
+	template<SaxHandler Handler>
+	void parseSax(std::string_view v, Handler& handler) {
+		SaxParser<Handler>(handler).parse(v);
+	}
+
+	// handler building Json nodes (used by JsonDecoder and JsonStreamDecoder)
+	class DomBuilder {
+	public:
+		// nodes are allocated from 'mem'; if 'borrowStrings' - strings without escape sequences borrow parsed text.
+		// Strings are unescaped and validated as utf-8
+		// If 'keys' - keys are interned in its pool
+		DomBuilder(std::pmr::memory_resource* mem = std::pmr::get_default_resource(), bool borrowStrings = false, JsonKeyPool::Cache* keys = nullptr);
+		inline void onStartObject() { stack.push_back(&add(ObjNode(mem, borrows))); }
+		inline void onKey(std::string_view raw) {
+			if (keys) {
+				if (auto interned = keys->intern(raw); interned) {
+					key.emplace(Str::borrow(*interned));
+					return;
+				}
+			}
+			key.emplace(makeStr(raw));
+		}
+		inline void onEndObject() { completeContainer(); }
+		inline void onStartArray() { stack.push_back(&add(ArrNode(mem, borrows))); }
+		inline void onEndArray() { completeContainer(); }
+		inline void onString(std::string_view s) { completeValue(ValNode(makeStr(s))); }
+		inline void onInt(int64_t val) { completeValue(ValNode(val)); }
+		inline void onDouble(double val) { completeValue(ValNode(val)); }
+		inline void onBool(bool val) { completeValue(ValNode(val)); }
+		inline void onNull() { completeValue(ValNode()); }
+		// root node is complete
+		inline bool done() const { return _done; }
+		// takes root node and resets builder
+		Node release();
+		void reset();
+	private:
+		inline Str makeStr(std::string_view raw) {
+			size_t esc = simd::findEscape(raw);
+			if (esc == raw.npos) {
+				return borrowStrings ? Str::borrow(raw) : Str(raw, mem);
+			}
+			// part before first escape sequence is already validated
+			std::pmr::string res(raw.size(), '\0', mem);
+			std::memcpy(res.data(), raw.data(), esc);
+			res.resize(esc + simd::unescapeStr(raw.substr(esc), res.data() + esc));
+			return Str(std::move(res));
+		}
+		// containers are built in place, so they are never moved. Ancestors of container being built don't get
+		// new elements until it is complete, so pointers in stack stay valid
+		inline Node& add(Node&& node) {
+			if (stack.empty()) {
+				root = std::move(node);
+				return root;
+			}
+			Node& top = *stack.back();
+			if (auto arr = std::get_if<ArrNode>(&top); arr) {
+				return arr->cont().emplace_back(std::move(node));
+			}
+			return std::get<ObjNode>(top).cont().insert_or_assign(std::move(*key), std::move(node)).first->second;
+		}
+		inline void completeValue(Node&& node) {
+			add(std::move(node));
+			_done = stack.empty();
+		}
+		inline void completeContainer() {
+			stack.pop_back();
+			_done = stack.empty();
+		}
+		std::pmr::memory_resource* mem;
+		bool borrowStrings;
+		JsonKeyPool::Cache* keys;
+		// nodes borrow parsed text or keys of pool - their copies are deep (see ArrNode)
+		bool borrows;
+		// containers being built
+		std::vector<Node*> stack;
+		// key of member being built. Emplaced rather than assigned - assignment doesn't propagate allocator,
+		// so arena keys would be copied to heap
+		std::optional<Str> key;
+		Node root;
+		bool _done = false;
+	};
+
+	template<SaxHandler Handler>
+	SaxParser<Handler>::SaxParser(Handler& handler, bool structuralIndex)
+		: handler{ handler }, structuralIndex{ structuralIndex }
+	{
+
+	}
+
+	template<SaxHandler Handler>
+	void SaxParser<Handler>::parse(std::string_view v) {
+		cur = Cursor{ v, 0 };
+		buildIndex(v, 0);
+		parseValue();
+		if (cur.peek() != '\0') {
+			throw std::runtime_error("JSON: unexpected characters after root node");
+		}
+	}
+
+	template<SaxHandler Handler>
+	size_t SaxParser<Handler>::parseMembers(std::string_view v, size_t start, size_t stop, bool object) {
+		cur = Cursor{ v, start };
+		// only the part up to 'stop' is indexed - the rest belongs to other parts. Strings crossing it are scanned
+		buildIndex(v.substr(start, std::min(stop, v.size()) - start), start);
+		char closing = object ? '}' : ']';
+		for (;;) {
+			if (object) {
+				if (cur.peek() != '"') {
+					throw std::runtime_error("invalid object node");
+				}
+				handler.onKey(parseRawStr());
+				cur.expect(':');
+			}
+			parseValue();
+			char ch = cur.peek();
+			if (ch == closing || (ch == ',' && cur.pos >= stop)) {
+				return cur.pos;
+			}
+			else if (ch != ',') {
+				throw std::runtime_error(object ? "invalid object node" : "invalid array node");
+			}
+			++cur.pos;
+		}
+	}
+
+	template<SaxHandler Handler>
+	void SaxParser<Handler>::buildIndex(std::string_view v, size_t offset) {
+		// positions of index are 32-bit
+		if (structuralIndex && v.size() >= IndexMinSize && v.size() + offset <= simd::MaxIndexedSize) {
+			index.clear();
+			// structural characters are usually less than quarter of json text
+			index.reserve(v.size() / 4 + 1);
+			simd::IndexState state;
+			simd::buildStructuralIndex(v, index, state, offset);
+			cur.idx = index.data();
+			cur.idxEnd = index.data() + index.size();
+		}
+	}
+
+	template<SaxHandler Handler>
+	void SaxParser<Handler>::parseValue() {
+		char ch = cur.peek();
+		switch (ch) {
+		case '{':
+			parseObj();
+			break;
+		case '[':
+			parseArr();
+			break;
+		case '"':
+			handler.onString(parseRawStr());
+			break;
+		case 't':
+			parseLiteral("true");
+			handler.onBool(true);
+			break;
+		case 'f':
+			parseLiteral("false");
+			handler.onBool(false);
+			break;
+		case 'n':
+			parseLiteral("null");
+			handler.onNull();
+			break;
+		default:
+			if (check::isNumberStart(ch)) {
+				parseNumber();
+				break;
+			}
+			throw std::logic_error("JSON: invalid node type");
+		}
+	}
+
+	template<SaxHandler Handler>
+	void SaxParser<Handler>::parseObj() {
+		cur.expect('{');
+		handler.onStartObject();
+		if (cur.peek() == '}') {
+			++cur.pos;
+			handler.onEndObject();
+			return;
+		}
+		for (;;) {
+			if (cur.peek() != '"') {
+				throw std::runtime_error("invalid object node");
+			}
+			handler.onKey(parseRawStr());
+			cur.expect(':');
+			parseValue();
+			char ch = cur.peek();
+			++cur.pos;
+			if (ch == '}') {
+				break;
+			}
+			else if (ch != ',') {
+				throw std::runtime_error("invalid object node");
+			}
+		}
+		handler.onEndObject();
+	}
+
+	template<SaxHandler Handler>
+	void SaxParser<Handler>::parseArr() {
+		cur.expect('[');
+		handler.onStartArray();
+		if (cur.peek() == ']') {
+			++cur.pos;
+			handler.onEndArray();
+			return;
+		}
+		for (;;) {
+			parseValue();
+			char ch = cur.peek();
+			++cur.pos;
+			if (ch == ']') {
+				break;
+			}
+			else if (ch != ',') {
+				throw std::runtime_error("invalid array node");
+			}
+		}
+		handler.onEndArray();
+	}
+
+	template<SaxHandler Handler>
+	void SaxParser<Handler>::parseNumber() {
+		auto val = utils::parseNumber(cur.v, cur.pos);
+		if (std::holds_alternative<int64_t>(val)) {
+			handler.onInt(std::get<int64_t>(val));
+		}
+		else {
+			handler.onDouble(std::get<double>(val));
+		}
+	}
+
+	template<SaxHandler Handler>
+	void SaxParser<Handler>::parseLiteral(std::string_view literal) {
+		if (cur.v.substr(cur.pos, literal.size()) != literal) {
+			throw std::runtime_error(literal == "null" ? "invalid null node" : "invalid bool node");
+		}
+		cur.pos += literal.size();
+	}
+
+	template<SaxHandler Handler>
+	std::string_view SaxParser<Handler>::parseRawStr() {
+		cur.expect('"');
+		size_t end = cur.idx ? cur.nextStructural(cur.pos) : cur.v.npos;
+		// index may cover only part of text (parseMembers())
+		if (end == cur.v.npos) {
+			end = utils::findStrEnd(cur.v, cur.pos);
+		}
+		if (end == cur.v.npos || cur.v[end] != '"') {
+			throw std::runtime_error("invalid string node");
+		}
+		std::string_view res = cur.v.substr(cur.pos, end - cur.pos);
+		cur.pos = end + 1;
+		return res;
+	}
+
+}
@@ -0,0 +1,782 @@
+#include "JsonSimd.hpp"
+#include <algorithm>
+#include <cstring>
+#include <array>
+#include <bit>
+#include <format>
+#include <stdexcept>
+#ifdef JSON_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#define JSON_NOINLINE __declspec(noinline)
+#else
+#define JSON_NOINLINE __attribute__((noinline))
+#endif
+
+using namespace util::web::json;
+using namespace util::web::json::simd;
+
+namespace {
+
+	constexpr size_t BlockSize = 64;
+
+	// one bit per byte of 64-byte block
+	struct BlockMasks {
+		uint64_t quote = 0;
+		uint64_t backslash = 0;
+		// '{', '}', '[', ']', ':', ','
+		uint64_t op = 0;
+	};
+
+	BlockMasks classifyScalar(const char* p) {
+		BlockMasks m;
+		for (size_t i = 0; i < BlockSize; ++i) {
+			uint64_t bit = uint64_t(1) << i;
+			switch (p[i]) {
+			case '"':
+				m.quote |= bit;
+				break;
+			case '\\':
+				m.backslash |= bit;
+				break;
+			case '{':
+			case '}':
+			case '[':
+			case ']':
+			case ':':
+			case ',':
+				m.op |= bit;
+				break;
+			default:
+				break;
+			}
+		}
+		return m;
+	}
+
+#ifdef JSON_SIMD_X86
+	__attribute__((target("sse4.2")))
+	inline BlockMasks classifySse42(const char* p) {
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i ops = _mm_setr_epi8('{', '}', '[', ']', ':', ',', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+		BlockMasks m;
+		for (size_t i = 0; i < BlockSize / 16; ++i) {
+			__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+			uint64_t q = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)));
+			uint64_t b = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash)));
+			// explicit lengths, so zero bytes in input are not treated as terminators
+			__m128i opMask = _mm_cmpestrm(ops, 6, chunk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK);
+			uint64_t o = static_cast<uint16_t>(_mm_cvtsi128_si32(opMask));
+			m.quote |= q << (i * 16);
+			m.backslash |= b << (i * 16);
+			m.op |= o << (i * 16);
+		}
+		return m;
+	}
+
+	__attribute__((target("avx2")))
+	inline BlockMasks classifyAvx2(const char* p) {
+		const __m256i quote = _mm256_set1_epi8('"');
+		const __m256i backslash = _mm256_set1_epi8('\\');
+		// '[' | 0x20 == '{' and ']' | 0x20 == '}'
+		const __m256i caseBit = _mm256_set1_epi8(0x20);
+		const __m256i openBrace = _mm256_set1_epi8('{');
+		const __m256i closeBrace = _mm256_set1_epi8('}');
+		const __m256i colon = _mm256_set1_epi8(':');
+		const __m256i comma = _mm256_set1_epi8(',');
+		BlockMasks m;
+		for (size_t i = 0; i < BlockSize / 32; ++i) {
+			__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i * 32));
+			__m256i lowered = _mm256_or_si256(chunk, caseBit);
+			__m256i op = _mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(lowered, openBrace), _mm256_cmpeq_epi8(lowered, closeBrace)),
+				_mm256_or_si256(_mm256_cmpeq_epi8(chunk, colon), _mm256_cmpeq_epi8(chunk, comma)));
+			uint64_t q = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote)));
+			uint64_t b = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, backslash)));
+			uint64_t o = static_cast<uint32_t>(_mm256_movemask_epi8(op));
+			m.quote |= q << (i * 32);
+			m.backslash |= b << (i * 32);
+			m.op |= o << (i * 32);
+		}
+		return m;
+	}
+#endif
+
+	// bit i of result is xor of bits 0..i of x
+	inline uint64_t prefixXor(uint64_t x) {
+		x ^= x << 1;
+		x ^= x << 2;
+		x ^= x << 4;
+		x ^= x << 8;
+		x ^= x << 16;
+		x ^= x << 32;
+		return x;
+	}
+
+	// returns mask of characters escaped by backslashes (odd-length backslash sequences escape next character)
+	inline uint64_t findEscaped(uint64_t backslash, uint64_t& prevEscaped) {
+		constexpr uint64_t EvenBits = 0x5555555555555555ULL;
+		// first character is escaped by previous block - it can't start a new escape sequence
+		backslash &= ~prevEscaped;
+		uint64_t followsEscape = (backslash << 1) | prevEscaped;
+		// sequences starting on odd bits get carried to the end of sequence by addition
+		uint64_t oddSequenceStarts = backslash & ~EvenBits & ~followsEscape;
+		uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+		// carry out of the block
+		prevEscaped = sequencesStartingOnEvenBits < backslash;
+		uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+		return (EvenBits ^ invertMask) & followsEscape;
+	}
+
+	inline void appendBits(std::vector<uint32_t>& index, uint64_t bits, size_t pos) {
+		while (bits) {
+			index.push_back(static_cast<uint32_t>(pos + std::countr_zero(bits)));
+			bits &= bits - 1;
+		}
+	}
+
+	template<BlockMasks(*Classify)(const char*)>
+	inline void buildIndexImpl(std::string_view v, std::vector<uint32_t>& index, IndexState& state, size_t offset) {
+		auto processBlock = [&](const char* p, size_t pos) {
+			BlockMasks m = Classify(p);
+			uint64_t quote = m.quote & ~findEscaped(m.backslash, state.escaped);
+			uint64_t inString = prefixXor(quote) ^ state.inString;
+			state.inString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+			// opening quote is inside string mask, closing one is not
+			appendBits(index, (m.op & ~inString) | quote, pos);
+		};
+		size_t pos = 0;
+		for (; pos + BlockSize <= v.size(); pos += BlockSize) {
+			processBlock(v.data() + pos, offset + pos);
+		}
+		if (pos < v.size()) {
+			char tail[BlockSize];
+			std::memset(tail, ' ', BlockSize);
+			std::memcpy(tail, v.data() + pos, v.size() - pos);
+			processBlock(tail, offset + pos);
+		}
+	}
+
+	void buildIndexScalar(std::string_view v, std::vector<uint32_t>& index, IndexState& state, size_t offset) {
+		buildIndexImpl<classifyScalar>(v, index, state, offset);
+	}
+
+#ifdef JSON_SIMD_X86
+	// flatten - so classifier gets inlined in context of its instruction set
+	__attribute__((target("sse4.2"), flatten))
+	void buildIndexSse42(std::string_view v, std::vector<uint32_t>& index, IndexState& state, size_t offset) {
+		buildIndexImpl<classifySse42>(v, index, state, offset);
+	}
+
+	__attribute__((target("avx2"), flatten))
+	void buildIndexAvx2(std::string_view v, std::vector<uint32_t>& index, IndexState& state, size_t offset) {
+		buildIndexImpl<classifyAvx2>(v, index, state, offset);
+	}
+#endif
+
+	// bytes which aren't copied as is by escapeStr: '"', '\\', control characters and non-ascii (validated)
+	constexpr auto SpecialBytes = []() {
+		std::array<bool, 256> res{};
+		for (size_t i = 0; i < 0x20; ++i) {
+			res[i] = true;
+		}
+		for (size_t i = 0x80; i < 0x100; ++i) {
+			res[i] = true;
+		}
+		res['"'] = true;
+		res['\\'] = true;
+		return res;
+	}();
+
+	// length of valid utf-8 sequence starting with non-ascii byte at 'pos', 0 if sequence is invalid
+	inline size_t utf8SeqLen(std::string_view v, size_t pos) {
+		auto cont = [&](size_t i, unsigned char lo = 0x80, unsigned char hi = 0xBF) {
+			if (pos + i >= v.size()) {
+				return false;
+			}
+			unsigned char ch = v[pos + i];
+			return ch >= lo && ch <= hi;
+		};
+		unsigned char lead = v[pos];
+		if (lead >= 0xC2 && lead <= 0xDF) {
+			return cont(1) ? 2 : 0;
+		}
+		if (lead >= 0xE0 && lead <= 0xEF) {
+			// overlong forms and surrogates
+			return cont(1, lead == 0xE0 ? 0xA0 : 0x80, lead == 0xED ? 0x9F : 0xBF) && cont(2) ? 3 : 0;
+		}
+		if (lead >= 0xF0 && lead <= 0xF4) {
+			// overlong forms and code points above U+10FFFF
+			return cont(1, lead == 0xF0 ? 0x90 : 0x80, lead == 0xF4 ? 0x8F : 0xBF) && cont(2) && cont(3) ? 4 : 0;
+		}
+		return 0;
+	}
+
+	// kept out of line - flattened escapers would inline whole std::format
+	[[noreturn]] JSON_NOINLINE void throwInvalidUtf8(size_t pos) {
+		throw std::runtime_error(std::format("JSON: invalid utf-8 sequence at position {} of string", pos));
+	}
+
+	[[noreturn]] JSON_NOINLINE void throwControlChar(size_t pos) {
+		throw std::runtime_error(std::format("JSON: unescaped control character at position {} of string", pos));
+	}
+
+	[[noreturn]] JSON_NOINLINE void throwInvalidEscape(size_t pos) {
+		throw std::runtime_error(std::format("JSON: invalid escape sequence at position {} of string", pos));
+	}
+
+	// handles special byte at 'pos' and returns position after it. Valid multibyte sequences stay in current run
+	// of bytes copied as is, escaped characters end it
+	inline size_t escapeSpecial(std::string_view v, size_t pos, size_t& runStart, std::string& out) {
+		unsigned char ch = v[pos];
+		if (ch >= 0x80) {
+			size_t len = utf8SeqLen(v, pos);
+			if (!len) {
+				throwInvalidUtf8(pos);
+			}
+			return pos + len;
+		}
+		out.append(v.data() + runStart, pos - runStart);
+		runStart = pos + 1;
+		switch (ch) {
+		case '"':
+			out.append("\\\"", 2);
+			break;
+		case '\\':
+			out.append("\\\\", 2);
+			break;
+		case '\b':
+			out.append("\\b", 2);
+			break;
+		case '\f':
+			out.append("\\f", 2);
+			break;
+		case '\n':
+			out.append("\\n", 2);
+			break;
+		case '\r':
+			out.append("\\r", 2);
+			break;
+		case '\t':
+			out.append("\\t", 2);
+			break;
+		default: {
+			constexpr char Hex[] = "0123456789abcdef";
+			char buf[6] = { '\\', 'u', '0', '0', Hex[ch >> 4], Hex[ch & 0xF] };
+			out.append(buf, sizeof(buf));
+			break;
+		}
+		}
+		return pos + 1;
+	}
+
+	// true if none of 8 bytes of 'word' is special (swar - checks existence only, not positions)
+	inline bool cleanWord(uint64_t word) {
+		constexpr uint64_t Ones = 0x0101010101010101ULL;
+		constexpr uint64_t High = Ones * 0x80;
+		auto hasZero = [](uint64_t w) { return (w - Ones) & ~w & High; };
+		uint64_t nonAscii = word & High;
+		uint64_t control = (word - Ones * 0x20) & ~word & High;
+		return !(nonAscii | control | hasZero(word ^ (Ones * '"')) | hasZero(word ^ (Ones * '\\')));
+	}
+
+	// true if none of bytes of 'v' (shorter than 16) is special - overlapping loads instead of loop over bytes
+	inline bool cleanShort(std::string_view v) {
+		const char* p = v.data();
+		size_t n = v.size();
+		if (n >= 8) {
+			uint64_t first, last;
+			std::memcpy(&first, p, sizeof(first));
+			std::memcpy(&last, p + n - 8, sizeof(last));
+			return cleanWord(first) && cleanWord(last);
+		}
+		if (n >= 4) {
+			uint32_t first, last;
+			std::memcpy(&first, p, sizeof(first));
+			std::memcpy(&last, p + n - 4, sizeof(last));
+			return cleanWord(first | (uint64_t(last) << 32));
+		}
+		if (n == 0) {
+			return true;
+		}
+		// padded with 'a'
+		constexpr uint64_t Padding = 0x6161616161000000ULL;
+		auto byte = [p](size_t i) { return uint64_t(static_cast<unsigned char>(p[i])); };
+		return cleanWord(Padding | byte(0) | (byte(n / 2) << 8) | (byte(n - 1) << 16));
+	}
+
+	// escapes v[pos..], v[runStart..pos) is known to be copied as is
+	void escapeScalar(std::string_view v, size_t pos, size_t runStart, std::string& out) {
+		while (pos < v.size()) {
+			if (pos + sizeof(uint64_t) <= v.size()) {
+				uint64_t word;
+				std::memcpy(&word, v.data() + pos, sizeof(word));
+				if (cleanWord(word)) {
+					pos += sizeof(word);
+					continue;
+				}
+			}
+			// word has special byte - checking its bytes one by one
+			for (size_t end = std::min(pos + sizeof(uint64_t), v.size()); pos < end;) {
+				if (SpecialBytes[static_cast<unsigned char>(v[pos])]) {
+					pos = escapeSpecial(v, pos, runStart, out);
+				}
+				else {
+					++pos;
+				}
+			}
+		}
+		out.append(v.data() + runStart, pos - runStart);
+	}
+
+#ifdef JSON_SIMD_X86
+	// skips blocks without special bytes, so clean runs are copied with a single append
+	template<uint32_t(*Special)(const char*), size_t Width>
+	inline void escapeImpl(std::string_view v, std::string& out) {
+		size_t pos = 0;
+		size_t runStart = 0;
+		while (pos + Width <= v.size()) {
+			uint32_t mask = Special(v.data() + pos);
+			if (mask) {
+				pos = escapeSpecial(v, pos + std::countr_zero(mask), runStart, out);
+			}
+			else {
+				pos += Width;
+			}
+		}
+		// avx2 tail can be up to 31 bytes
+		if (v.size() - pos < 16 && cleanShort(v.substr(pos))) {
+			out.append(v.data() + runStart, v.size() - runStart);
+			return;
+		}
+		escapeScalar(v, pos, runStart, out);
+	}
+#endif
+
+	// true if none of 8 bytes of 'word' is backslash, non-ascii or (unless 'AllowControl') control character
+	template<bool AllowControl>
+	inline bool plainWord(uint64_t word) {
+		constexpr uint64_t Ones = 0x0101010101010101ULL;
+		constexpr uint64_t High = Ones * 0x80;
+		uint64_t backslash = word ^ (Ones * '\\');
+		uint64_t special = (word & High) | ((backslash - Ones) & ~backslash & High);
+		if constexpr (!AllowControl) {
+			// bytes below 0x20
+			special |= (word - Ones * 0x20) & ~word & High;
+		}
+		return !special;
+	}
+
+	// validates utf-8 sequence starting with non-ascii byte at 'pos', returns position after it
+	inline size_t skipUtf8Seq(std::string_view v, size_t pos) {
+		size_t len = utf8SeqLen(v, pos);
+		if (!len) {
+			throwInvalidUtf8(pos);
+		}
+		return pos + len;
+	}
+
+	// json strings can't have raw control characters (AllowControl - for strings of binary formats)
+	template<bool AllowControl>
+	size_t findEscapeScalar(std::string_view v, size_t pos) {
+		while (pos < v.size()) {
+			if (pos + sizeof(uint64_t) <= v.size()) {
+				uint64_t word;
+				std::memcpy(&word, v.data() + pos, sizeof(word));
+				if (plainWord<AllowControl>(word)) {
+					pos += sizeof(word);
+					continue;
+				}
+			}
+			for (size_t end = std::min(pos + sizeof(uint64_t), v.size()); pos < end;) {
+				unsigned char ch = v[pos];
+				if (ch == '\\') {
+					return pos;
+				}
+				if (!AllowControl && ch < 0x20) {
+					throwControlChar(pos);
+				}
+				pos = ch < 0x80 ? pos + 1 : skipUtf8Seq(v, pos);
+			}
+		}
+		return v.npos;
+	}
+
+#ifdef JSON_SIMD_X86
+	template<uint32_t(*Special)(const char*), size_t Width, bool AllowControl>
+	inline size_t findEscapeImpl(std::string_view v, size_t pos) {
+		while (pos + Width <= v.size()) {
+			uint32_t mask = Special(v.data() + pos);
+			if (!mask) {
+				pos += Width;
+				continue;
+			}
+			pos += std::countr_zero(mask);
+			if (v[pos] == '\\') {
+				return pos;
+			}
+			if (static_cast<unsigned char>(v[pos]) < 0x20) {
+				throwControlChar(pos);
+			}
+			pos = skipUtf8Seq(v, pos);
+		}
+		return findEscapeScalar<AllowControl>(v, pos);
+	}
+#endif
+
+	inline uint32_t parseHex4(std::string_view v, size_t pos) {
+		if (pos + 4 > v.size()) {
+			throwInvalidEscape(pos);
+		}
+		uint32_t res = 0;
+		for (size_t i = pos; i < pos + 4; ++i) {
+			char ch = v[i];
+			uint32_t digit;
+			if (ch >= '0' && ch <= '9') {
+				digit = ch - '0';
+			}
+			else if (ch >= 'a' && ch <= 'f') {
+				digit = ch - 'a' + 10;
+			}
+			else if (ch >= 'A' && ch <= 'F') {
+				digit = ch - 'A' + 10;
+			}
+			else {
+				throwInvalidEscape(pos);
+			}
+			res = (res << 4) | digit;
+		}
+		return res;
+	}
+
+	inline size_t appendUtf8(uint32_t cp, char* out) {
+		if (cp < 0x80) {
+			out[0] = static_cast<char>(cp);
+			return 1;
+		}
+		if (cp < 0x800) {
+			out[0] = static_cast<char>(0xC0 | (cp >> 6));
+			out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+			return 2;
+		}
+		if (cp < 0x10000) {
+			out[0] = static_cast<char>(0xE0 | (cp >> 12));
+			out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+			out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+			return 3;
+		}
+		out[0] = static_cast<char>(0xF0 | (cp >> 18));
+		out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+		out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+		out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+		return 4;
+	}
+
+	// unescapes sequence starting with backslash at 'pos', appends result to out[n..] and returns position after it
+	inline size_t unescapeSeq(std::string_view v, size_t pos, char* out, size_t& n) {
+		if (pos + 1 >= v.size()) {
+			throwInvalidEscape(pos);
+		}
+		char ch = v[pos + 1];
+		switch (ch) {
+		case '"':
+		case '\\':
+		case '/':
+			out[n++] = ch;
+			return pos + 2;
+		case 'b':
+			out[n++] = '\b';
+			return pos + 2;
+		case 'f':
+			out[n++] = '\f';
+			return pos + 2;
+		case 'n':
+			out[n++] = '\n';
+			return pos + 2;
+		case 'r':
+			out[n++] = '\r';
+			return pos + 2;
+		case 't':
+			out[n++] = '\t';
+			return pos + 2;
+		case 'u':
+			break;
+		default:
+			throwInvalidEscape(pos);
+		}
+		uint32_t cp = parseHex4(v, pos + 2);
+		size_t next = pos + 6;
+		if (cp >= 0xD800 && cp <= 0xDBFF) {
+			// high surrogate should be followed by low one
+			if (next + 1 >= v.size() || v[next] != '\\' || v[next + 1] != 'u') {
+				throwInvalidEscape(pos);
+			}
+			uint32_t low = parseHex4(v, next + 2);
+			if (low < 0xDC00 || low > 0xDFFF) {
+				throwInvalidEscape(pos);
+			}
+			cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+			next += 6;
+		}
+		else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+			throwInvalidEscape(pos);
+		}
+		n += appendUtf8(cp, out + n);
+		return next;
+	}
+
+	// runs between escape sequences are found by 'FindEscape' and copied at once
+	template<size_t(*FindEscape)(std::string_view, size_t)>
+	inline size_t unescapeImpl(std::string_view v, char* out) {
+		size_t pos = 0;
+		size_t n = 0;
+		for (;;) {
+			size_t esc = FindEscape(v, pos);
+			size_t end = esc == v.npos ? v.size() : esc;
+			std::memcpy(out + n, v.data() + pos, end - pos);
+			n += end - pos;
+			if (esc == v.npos) {
+				return n;
+			}
+			pos = unescapeSeq(v, esc, out, n);
+		}
+	}
+
+	size_t unescapeScalar(std::string_view v, char* out) {
+		return unescapeImpl<findEscapeScalar<false>>(v, out);
+	}
+
+#ifdef JSON_SIMD_X86
+	// bit per byte which is '"', '\\', control character (unsigned <= 0x1f) or non-ascii (sign bit)
+	__attribute__((target("sse4.2")))
+	inline uint32_t specialSse42(const char* p) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i quote = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'));
+		__m128i backslash = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'));
+		__m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, _mm_set1_epi8(0x1f)), chunk);
+		__m128i special = _mm_or_si128(_mm_or_si128(quote, backslash), _mm_or_si128(control, chunk));
+		return static_cast<uint16_t>(_mm_movemask_epi8(special));
+	}
+
+	__attribute__((target("avx2")))
+	inline uint32_t specialAvx2(const char* p) {
+		__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i quote = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'));
+		__m256i backslash = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'));
+		__m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, _mm256_set1_epi8(0x1f)), chunk);
+		__m256i special = _mm256_or_si256(_mm256_or_si256(quote, backslash), _mm256_or_si256(control, chunk));
+		return static_cast<uint32_t>(_mm256_movemask_epi8(special));
+	}
+
+	// bit per byte which is '\\', non-ascii or (unless 'AllowControl') control character
+	template<bool AllowControl>
+	__attribute__((target("sse4.2")))
+	inline uint32_t backslashSse42(const char* p) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')), chunk);
+		if constexpr (!AllowControl) {
+			special = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_min_epu8(chunk, _mm_set1_epi8(0x1f)), chunk));
+		}
+		return static_cast<uint16_t>(_mm_movemask_epi8(special));
+	}
+
+	template<bool AllowControl>
+	__attribute__((target("avx2")))
+	inline uint32_t backslashAvx2(const char* p) {
+		__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\')), chunk);
+		if constexpr (!AllowControl) {
+			special = _mm256_or_si256(special, _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, _mm256_set1_epi8(0x1f)), chunk));
+		}
+		return static_cast<uint32_t>(_mm256_movemask_epi8(special));
+	}
+
+	template<bool AllowControl>
+	__attribute__((target("sse4.2"), flatten))
+	size_t findEscapeSse42(std::string_view v, size_t pos) {
+		return findEscapeImpl<backslashSse42<AllowControl>, 16, AllowControl>(v, pos);
+	}
+
+	template<bool AllowControl>
+	__attribute__((target("avx2"), flatten))
+	size_t findEscapeAvx2(std::string_view v, size_t pos) {
+		return findEscapeImpl<backslashAvx2<AllowControl>, 32, AllowControl>(v, pos);
+	}
+
+	size_t unescapeSse42(std::string_view v, char* out) {
+		return unescapeImpl<findEscapeSse42<false>>(v, out);
+	}
+
+	size_t unescapeAvx2(std::string_view v, char* out) {
+		return unescapeImpl<findEscapeAvx2<false>>(v, out);
+	}
+
+	__attribute__((target("sse4.2"), flatten))
+	void escapeSse42(std::string_view v, std::string& out) {
+		escapeImpl<specialSse42, 16>(v, out);
+	}
+
+	__attribute__((target("avx2"), flatten))
+	void escapeAvx2(std::string_view v, std::string& out) {
+		escapeImpl<specialAvx2, 32>(v, out);
+	}
+#endif
+
+}
+
+Isa simd::detectIsa() {
+	static const Isa isa = []() {
+#ifdef JSON_SIMD_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			return Isa::Avx2;
+		}
+		if (__builtin_cpu_supports("sse4.2")) {
+			return Isa::Sse42;
+		}
+#endif
+		return Isa::Scalar;
+	}();
+	return isa;
+}
+
+const char* simd::isaName(Isa isa) {
+	switch (isa) {
+	case Isa::Avx2:
+		return "avx2";
+	case Isa::Sse42:
+		return "sse4.2";
+	default:
+		return "scalar";
+	}
+}
+
+void simd::buildStructuralIndex(std::string_view v, std::vector<uint32_t>& index, IndexState& state, size_t offset) {
+	buildStructuralIndex(v, index, state, offset, detectIsa());
+}
+
+void simd::buildStructuralIndex(std::string_view v, std::vector<uint32_t>& index, IndexState& state, size_t offset, Isa isa) {
+	if (v.size() + offset > MaxIndexedSize) {
+		throw std::runtime_error("JSON: input is too large for structural index");
+	}
+	// never running instructions which cpu doesn't support
+	isa = std::min(isa, detectIsa());
+	switch (isa) {
+#ifdef JSON_SIMD_X86
+	case Isa::Avx2:
+		buildIndexAvx2(v, index, state, offset);
+		break;
+	case Isa::Sse42:
+		buildIndexSse42(v, index, state, offset);
+		break;
+#endif
+	default:
+		buildIndexScalar(v, index, state, offset);
+		break;
+	}
+}
+
+std::vector<uint32_t> simd::structuralIndex(std::string_view v) {
+	std::vector<uint32_t> index;
+	// structural characters are usually less than quarter of json text
+	index.reserve(v.size() / 4 + 1);
+	IndexState state;
+	buildStructuralIndex(v, index, state);
+	return index;
+}
+
+void simd::escapeStr(std::string_view v, std::string& out) {
+	escapeStr(v, out, detectIsa());
+}
+
+void simd::escapeStr(std::string_view v, std::string& out, Isa isa) {
+	// most of keys and short values
+	if (v.size() < 16) {
+		if (cleanShort(v)) {
+			out.append(v);
+		}
+		else {
+			escapeScalar(v, 0, 0, out);
+		}
+		return;
+	}
+	isa = std::min(isa, detectIsa());
+	switch (isa) {
+#ifdef JSON_SIMD_X86
+	case Isa::Avx2:
+		escapeAvx2(v, out);
+		break;
+	case Isa::Sse42:
+		escapeSse42(v, out);
+		break;
+#endif
+	default:
+		escapeScalar(v, 0, 0, out);
+		break;
+	}
+}
+
+size_t simd::findEscape(std::string_view v) {
+	return findEscape(v, detectIsa());
+}
+
+size_t simd::findEscape(std::string_view v, Isa isa) {
+	// short strings (most of keys) - swar is enough
+	if (v.size() < 16) {
+		isa = Isa::Scalar;
+	}
+	isa = std::min(isa, detectIsa());
+	switch (isa) {
+#ifdef JSON_SIMD_X86
+	case Isa::Avx2:
+		return findEscapeAvx2<false>(v, 0);
+	case Isa::Sse42:
+		return findEscapeSse42<false>(v, 0);
+#endif
+	default:
+		return findEscapeScalar<false>(v, 0);
+	}
+}
+
+void simd::validateUtf8(std::string_view v) {
+	Isa isa = v.size() < 16 ? Isa::Scalar : detectIsa();
+	// backslash is a plain character here - scan is resumed after it
+	for (size_t pos = 0; pos < v.size(); ++pos) {
+		switch (isa) {
+#ifdef JSON_SIMD_X86
+		case Isa::Avx2:
+			pos = findEscapeAvx2<true>(v, pos);
+			break;
+		case Isa::Sse42:
+			pos = findEscapeSse42<true>(v, pos);
+			break;
+#endif
+		default:
+			pos = findEscapeScalar<true>(v, pos);
+		}
+		if (pos == v.npos) {
+			break;
+		}
+	}
+}
+
+size_t simd::unescapeStr(std::string_view v, char* out) {
+	return unescapeStr(v, out, detectIsa());
+}
+
+size_t simd::unescapeStr(std::string_view v, char* out, Isa isa) {
+	isa = std::min(isa, detectIsa());
+	switch (isa) {
+#ifdef JSON_SIMD_X86
+	case Isa::Avx2:
+		return unescapeAvx2(v, out);
+	case Isa::Sse42:
+		return unescapeSse42(v, out);
+#endif
+	default:
+		return unescapeScalar(v, out);
+	}
+}
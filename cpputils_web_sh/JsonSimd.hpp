@@ -0,0 +1,61 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// vectorized helpers for json decoding/encoding
+// x86 builds pick the widest supported instruction set at runtime, other platforms use scalar code
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define JSON_SIMD_X86 1
+#endif
+
+namespace util::web::json::simd {
+
+	enum class Isa {
+		Scalar,
+		Sse42,
+		Avx2
+	};
+
+	// best instruction set supported by current cpu (detected once)
+	Isa detectIsa();
+	const char* isaName(Isa isa);
+
+	// carried between consecutive blocks of the same input
+	struct IndexState {
+		// all ones if previous block has ended inside a string
+		uint64_t inString = 0;
+		// 1 if last character of previous block is an unescaped backslash
+		uint64_t escaped = 0;
+	};
+
+	// stage-1 of decoding: appends positions of all structural characters to 'index' -
+	// unescaped quotes (both opening and closing) and '{', '}', '[', ']', ':', ',' outside strings.
+	// Positions are relative to v.data() plus 'offset'. They are 32-bit: throws std::runtime_error
+	// if v.size() + offset exceeds MaxIndexedSize (callers scan such inputs without index)
+	constexpr size_t MaxIndexedSize = UINT32_MAX;
+	void buildStructuralIndex(std::string_view v, std::vector<uint32_t>& index, IndexState& state, size_t offset = 0);
+	void buildStructuralIndex(std::string_view v, std::vector<uint32_t>& index, IndexState& state, size_t offset, Isa isa);
+	std::vector<uint32_t> structuralIndex(std::string_view v);
+
+	// encoding: appends 'v' escaped as json string contents (without quotes) to 'out'.
+	// Runs without '"', '\\' and control characters are copied in bulk. Validates utf-8 in the same pass,
+	// throws std::runtime_error on invalid sequences (overlong, surrogates, truncated)
+	void escapeStr(std::string_view v, std::string& out);
+	void escapeStr(std::string_view v, std::string& out, Isa isa);
+
+	// decoding: position of first backslash of json string contents 'v' (v.npos if there is none).
+	// Validates utf-8 before it, throws std::runtime_error on invalid sequences and unescaped control characters
+	size_t findEscape(std::string_view v);
+	size_t findEscape(std::string_view v, Isa isa);
+	// writes unescaped 'v' to 'out' (result is never longer than 'v', so 'out' should have room for v.size() bytes)
+	// and returns size of result. \uXXXX surrogate pairs are combined. Validates escape sequences and utf-8,
+	// throws std::runtime_error on invalid ones and on unescaped control characters
+	size_t unescapeStr(std::string_view v, char* out);
+	size_t unescapeStr(std::string_view v, char* out, Isa isa);
+
+	// throws std::runtime_error if 'v' (string without escaping, f.e. of binary formats) isn't valid utf-8
+	void validateUtf8(std::string_view v);
+
+}
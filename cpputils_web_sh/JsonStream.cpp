@@ -0,0 +1,286 @@
+#include "JsonStream.hpp"
+#include <stdexcept>
+#include <format>
+
+using namespace util::web::json;
+
+namespace {
+
+	inline bool isNumberChar(char ch) {
+		return (ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E';
+	}
+
+}
+
+JsonStreamDecoder::JsonStreamDecoder() {
+
+}
+
+void JsonStreamDecoder::feed(std::span<const uint8_t> chunk) {
+	feed(std::string_view(reinterpret_cast<const char*>(chunk.data()), chunk.size()));
+}
+
+void JsonStreamDecoder::feed(std::string_view v) {
+	size_t pos = 0;
+	while (pos < v.size()) {
+		switch (state) {
+		case State::Str:
+			pos = feedStr(v, pos);
+			continue;
+		case State::Number:
+			pos = feedNumber(v, pos);
+			continue;
+		case State::Literal:
+			pos = feedLiteral(v, pos);
+			continue;
+		default:
+			break;
+		}
+		pos = utils::skipSpaces(v, pos);
+		if (pos == v.size()) {
+			break;
+		}
+		char ch = v[pos];
+		switch (state) {
+		case State::Value:
+			pos = feedValue(v, pos);
+			break;
+		case State::ArrFirst:
+			if (ch == ']') {
+				++pos;
+				completeContainer();
+			}
+			else {
+				pos = feedValue(v, pos);
+			}
+			break;
+		case State::ArrNext:
+			++pos;
+			if (ch == ',') {
+				state = State::Value;
+			}
+			else if (ch == ']') {
+				completeContainer();
+			}
+			else {
+				throw std::runtime_error("invalid array node");
+			}
+			break;
+		case State::ObjFirst:
+		case State::ObjKey:
+			++pos;
+			if (ch == '"') {
+				strIsKey = true;
+				state = State::Str;
+			}
+			else if (ch == '}' && state == State::ObjFirst) {
+				completeContainer();
+			}
+			else {
+				throw std::runtime_error("invalid object node");
+			}
+			break;
+		case State::ObjColon:
+			if (ch != ':') {
+				throw std::runtime_error(std::format("JSON: expected ':' at position {}", consumed + pos));
+			}
+			++pos;
+			state = State::Value;
+			break;
+		case State::ObjNext:
+			++pos;
+			if (ch == ',') {
+				state = State::ObjKey;
+			}
+			else if (ch == '}') {
+				completeContainer();
+			}
+			else {
+				throw std::runtime_error("invalid object node");
+			}
+			break;
+		default:
+			throw std::runtime_error("JSON: unexpected characters after root node");
+		}
+	}
+	consumed += v.size();
+}
+
+Json JsonStreamDecoder::finish() {
+	// number can't tell it has ended until next character
+	if (state == State::Number && containers.empty()) {
+		std::string raw = std::move(token);
+		token.clear();
+		completeNumber(raw);
+	}
+	// same as decoding empty string
+	if (state == State::Value && containers.empty()) {
+		reset();
+		return Json();
+	}
+	if (state != State::Done) {
+		throw std::runtime_error("JSON: unexpected end of input");
+	}
+	Json res(builder.release());
+	reset();
+	return res;
+}
+
+void JsonStreamDecoder::reset() {
+	builder.reset();
+	containers.clear();
+	state = State::Value;
+	token.clear();
+	strIsKey = false;
+	escaped = false;
+	consumed = 0;
+}
+
+size_t JsonStreamDecoder::feedValue(std::string_view v, size_t pos) {
+	char ch = v[pos];
+	switch (ch) {
+	case '{':
+		builder.onStartObject();
+		containers.push_back('{');
+		state = State::ObjFirst;
+		return pos + 1;
+	case '[':
+		builder.onStartArray();
+		containers.push_back('[');
+		state = State::ArrFirst;
+		return pos + 1;
+	case '"':
+		strIsKey = false;
+		state = State::Str;
+		return pos + 1;
+	case 't':
+	case 'f':
+	case 'n':
+		state = State::Literal;
+		return pos;
+	default:
+		if (check::isNumberStart(ch)) {
+			state = State::Number;
+			return pos;
+		}
+		throw std::logic_error("JSON: invalid node type");
+	}
+}
+
+size_t JsonStreamDecoder::feedStr(std::string_view v, size_t pos) {
+	size_t end = pos;
+	for (; end < v.size(); ++end) {
+		if (escaped) {
+			escaped = false;
+		}
+		else if (v[end] == '\\') {
+			escaped = true;
+		}
+		else if (v[end] == '"') {
+			break;
+		}
+	}
+	if (end == v.size()) {
+		token.append(v.substr(pos));
+		return end;
+	}
+	// whole string is inside this chunk - no copying into token
+	if (token.empty()) {
+		completeStr(v.substr(pos, end - pos));
+	}
+	else {
+		token.append(v.substr(pos, end - pos));
+		completeStr(token);
+		token.clear();
+	}
+	return end + 1;
+}
+
+size_t JsonStreamDecoder::feedNumber(std::string_view v, size_t pos) {
+	size_t end = pos;
+	while (end < v.size() && isNumberChar(v[end])) {
+		++end;
+	}
+	if (end == v.size()) {
+		token.append(v.substr(pos));
+		return end;
+	}
+	if (token.empty()) {
+		completeNumber(v.substr(pos, end - pos));
+	}
+	else {
+		token.append(v.substr(pos, end - pos));
+		completeNumber(token);
+		token.clear();
+	}
+	return end;
+}
+
+size_t JsonStreamDecoder::feedLiteral(std::string_view v, size_t pos) {
+	char first = token.empty() ? v[pos] : token.front();
+	std::string_view literal = first == 't' ? "true" : (first == 'f' ? "false" : "null");
+	size_t n = std::min(literal.size() - token.size(), v.size() - pos);
+	token.append(v.substr(pos, n));
+	if (token.size() < literal.size()) {
+		return pos + n;
+	}
+	if (token != literal) {
+		throw std::runtime_error(first == 'n' ? "invalid null node" : "invalid bool node");
+	}
+	token.clear();
+	if (first == 'n') {
+		builder.onNull();
+	}
+	else {
+		builder.onBool(first == 't');
+	}
+	completeValue();
+	return pos + n;
+}
+
+void JsonStreamDecoder::completeStr(std::string_view raw) {
+	if (strIsKey) {
+		builder.onKey(raw);
+		state = State::ObjColon;
+	}
+	else {
+		builder.onString(raw);
+		completeValue();
+	}
+}
+
+void JsonStreamDecoder::completeNumber(std::string_view raw) {
+	size_t pos = 0;
+	auto val = utils::parseNumber(raw, pos);
+	// token is made of any number characters, f.e. "1-2"
+	if (pos != raw.size()) {
+		throw std::runtime_error("invalid int node");
+	}
+	if (std::holds_alternative<int64_t>(val)) {
+		builder.onInt(std::get<int64_t>(val));
+	}
+	else {
+		builder.onDouble(std::get<double>(val));
+	}
+	completeValue();
+}
+
+void JsonStreamDecoder::completeContainer() {
+	if (containers.back() == '{') {
+		builder.onEndObject();
+	}
+	else {
+		builder.onEndArray();
+	}
+	containers.pop_back();
+	completeValue();
+}
+
+void JsonStreamDecoder::completeValue() {
+	if (containers.empty()) {
+		state = State::Done;
+	}
+	else {
+		state = containers.back() == '{' ? State::ObjNext : State::ArrNext;
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <span>
+#include "JsonSax.hpp"
+
+namespace util::web::json {
+
+	// resumable push decoder: input is fed in chunks as it arrives (f.e. from InputSocketBuffer),
+	// and the document is built while the rest of it is still being received.
+	// Chunks may be split anywhere, including inside strings, numbers and literals - unfinished token is kept
+	// until the next chunk. Chunk's memory isn't referenced after feed() returns, so it can be released right away.
+	// After an exception decoder should be reset() before feeding a new document.
+	class JsonStreamDecoder {
+	public:
+		JsonStreamDecoder();
+		void feed(std::string_view chunk);
+		// f.e. InputSocketBuffer::get()
+		void feed(std::span<const uint8_t> chunk);
+		// root value is complete (only whitespaces may follow)
+		inline bool done() const { return state == State::Done; }
+		// returns decoded document and resets decoder; throws if input has ended in the middle of document
+		Json finish();
+		void reset();
+	private:
+		enum class State {
+			// expecting value
+			Value,
+			// after '[' - value or ']'
+			ArrFirst,
+			// after array element - ',' or ']'
+			ArrNext,
+			// after '{' - key or '}'
+			ObjFirst,
+			// after ',' in object - key
+			ObjKey,
+			// after key - ':'
+			ObjColon,
+			// after member - ',' or '}'
+			ObjNext,
+			// inside token
+			Str,
+			Number,
+			Literal,
+			Done
+		};
+		// each method consumes input starting at 'pos' and returns position after consumed part
+		size_t feedValue(std::string_view v, size_t pos);
+		size_t feedStr(std::string_view v, size_t pos);
+		size_t feedNumber(std::string_view v, size_t pos);
+		size_t feedLiteral(std::string_view v, size_t pos);
+		void completeStr(std::string_view raw);
+		void completeNumber(std::string_view raw);
+		void completeContainer();
+		// sets state after value is complete
+		void completeValue();
+
+		// events are delivered to builder as soon as tokens are complete
+		DomBuilder builder;
+		// '{' or '[' for each open container
+		std::string containers;
+		State state = State::Value;
+		// beginning of token which has been split by chunk boundary
+		std::string token;
+		bool strIsKey = false;
+		// last character of previous chunk is unescaped backslash inside string
+		bool escaped = false;
+		// bytes of previous chunks, for error messages
+		size_t consumed = 0;
+	};
+
+}
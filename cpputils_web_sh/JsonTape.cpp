@@ -0,0 +1,306 @@
+#include "JsonTape.hpp"
+#include "JsonSax.hpp"
+#include <stdexcept>
+#include <cstring>
+
+using namespace util::string;
+using namespace util::web::json;
+
+// SaxParser handler writing tape
+class JsonTape::Builder {
+public:
+	Builder(JsonTape& doc, size_t inputSize)
+		: doc{ doc }
+	{
+		// rough estimates, avoiding most of reallocations
+		doc.tape.reserve(inputSize / 8 + 1);
+		doc.strings.reserve(inputSize / 2);
+	}
+	inline void onStartObject() { open(Tag::Object); }
+	// keys are not elements
+	inline void onKey(std::string_view key) { addStr(key); }
+	inline void onEndObject() { close(Tag::ObjectEnd); }
+	inline void onStartArray() { open(Tag::Array); }
+	inline void onEndArray() { close(Tag::ArrayEnd); }
+	inline void onString(std::string_view s) {
+		element();
+		addStr(s);
+	}
+	inline void onInt(int64_t val) {
+		element();
+		doc.tape.push_back(makeWord(Tag::Int, 0));
+		doc.tape.push_back(static_cast<uint64_t>(val));
+	}
+	inline void onDouble(double val) {
+		element();
+		uint64_t raw;
+		std::memcpy(&raw, &val, sizeof(raw));
+		doc.tape.push_back(makeWord(Tag::Float, 0));
+		doc.tape.push_back(raw);
+	}
+	inline void onBool(bool val) {
+		element();
+		doc.tape.push_back(makeWord(val ? Tag::True : Tag::False, 0));
+	}
+	inline void onNull() {
+		element();
+		doc.tape.push_back(makeWord(Tag::Null, 0));
+	}
+private:
+	// container being written
+	struct Frame {
+		size_t start;
+		uint64_t count = 0;
+	};
+
+	inline void element() {
+		if (!stack.empty()) {
+			++stack.back().count;
+		}
+	}
+
+	inline void open(Tag tag) {
+		element();
+		stack.push_back(Frame{ doc.tape.size() });
+		// patched when container is closed
+		doc.tape.push_back(makeWord(tag, 0));
+	}
+
+	inline void close(Tag tag) {
+		Frame frame = stack.back();
+		stack.pop_back();
+		size_t end = doc.tape.size();
+		if (end >= (uint64_t(1) << CountShift)) {
+			throw std::runtime_error("JSON: document is too large for tape");
+		}
+		doc.tape[frame.start] |= (std::min(frame.count, MaxCount) << CountShift) | end;
+		doc.tape.push_back(makeWord(tag, frame.start));
+	}
+
+	inline void addStr(std::string_view raw) {
+		if (raw.size() > UINT32_MAX) {
+			throw std::runtime_error("JSON: string is too large for tape");
+		}
+		size_t offset = doc.strings.size();
+		doc.tape.push_back(makeWord(Tag::String, offset));
+		size_t esc = simd::findEscape(raw);
+		uint32_t len = static_cast<uint32_t>(raw.size());
+		doc.strings.append(reinterpret_cast<const char*>(&len), sizeof(len));
+		doc.strings.append(raw);
+		if (esc != raw.npos) {
+			// unescaped in place - result is never longer
+			char* data = doc.strings.data() + offset + sizeof(len);
+			len = static_cast<uint32_t>(esc + simd::unescapeStr(raw.substr(esc), data + esc));
+			std::memcpy(doc.strings.data() + offset, &len, sizeof(len));
+			doc.strings.resize(offset + sizeof(len) + len);
+		}
+	}
+
+	JsonTape& doc;
+	std::vector<Frame> stack;
+};
+
+JsonTape::JsonTape() {
+
+}
+
+JsonTape::JsonTape(std::string_view v) {
+	if (v.empty()) return;
+	Builder builder(*this, v.size());
+	SaxParser<Builder>(builder).parse(v);
+	tape.shrink_to_fit();
+	strings.shrink_to_fit();
+}
+
+bool JsonTape::empty() const {
+	return tape.empty();
+}
+
+NodeType JsonTape::type() const {
+	return root().type();
+}
+
+std::vector<std::string> JsonTape::keys() const {
+	return root().keys();
+}
+
+std::vector<std::string> JsonTape::keys(const std::string& key) const {
+	return root().keys(key);
+}
+
+size_t JsonTape::arrSize() const {
+	return root().arrSize();
+}
+
+size_t JsonTape::arrSize(const std::string& key) const {
+	return root().arrSize(key);
+}
+
+TapeRef JsonTape::root() const {
+	return empty() ? TapeRef() : TapeRef(this, 0);
+}
+
+TapeRef JsonTape::get(const std::string& key) const {
+	return root().get(key);
+}
+
+size_t JsonTape::footprint() const {
+	return tape.capacity() * sizeof(uint64_t) + strings.capacity();
+}
+
+size_t JsonTape::next(size_t idx) const {
+	uint64_t word = tape[idx];
+	switch (tagOf(word)) {
+	case Tag::Object:
+	case Tag::Array:
+		return (payloadOf(word) & ((uint64_t(1) << CountShift) - 1)) + 1;
+	case Tag::Int:
+	case Tag::Float:
+		return idx + 2;
+	default:
+		return idx + 1;
+	}
+}
+
+std::string_view JsonTape::str(size_t idx) const {
+	size_t offset = payloadOf(tape[idx]);
+	uint32_t len;
+	std::memcpy(&len, strings.data() + offset, sizeof(len));
+	return std::string_view(strings.data() + offset + sizeof(len), len);
+}
+
+TapeRef::TapeRef() {
+
+}
+
+TapeRef::TapeRef(const JsonTape* doc, size_t idx)
+	: doc{ doc }, idx{ idx }
+{
+
+}
+
+bool TapeRef::empty() const {
+	return doc == nullptr;
+}
+
+NodeType TapeRef::type() const {
+	if (empty()) {
+		return NodeType::NoType;
+	}
+	switch (JsonTape::tagOf(doc->tape[idx])) {
+	case JsonTape::Tag::Object:
+		return NodeType::Object;
+	case JsonTape::Tag::Array:
+		return NodeType::Array;
+	case JsonTape::Tag::String:
+		return NodeType::String;
+	case JsonTape::Tag::Int:
+		return NodeType::Int;
+	case JsonTape::Tag::Float:
+		return NodeType::Float;
+	case JsonTape::Tag::True:
+	case JsonTape::Tag::False:
+		return NodeType::Bool;
+	case JsonTape::Tag::Null:
+		return NodeType::Null;
+	default:
+		return NodeType::NoType;
+	}
+}
+
+std::vector<std::string> TapeRef::keys() const {
+	if (type() != NodeType::Object) {
+		throw std::logic_error("JSON: not an object node");
+	}
+	std::vector<std::string> res;
+	for (size_t i = idx + 1; JsonTape::tagOf(doc->tape[i]) != JsonTape::Tag::ObjectEnd; i = doc->next(i + 1)) {
+		res.emplace_back(doc->str(i));
+	}
+	return res;
+}
+
+std::vector<std::string> TapeRef::keys(const std::string& key) const {
+	return get(key).keys();
+}
+
+size_t TapeRef::arrSize() const {
+	if (type() != NodeType::Array) {
+		throw std::logic_error("JSON: not an array node");
+	}
+	uint64_t count = JsonTape::payloadOf(doc->tape[idx]) >> JsonTape::CountShift;
+	if (count < JsonTape::MaxCount) {
+		return count;
+	}
+	// saturated - counting
+	size_t res = 0;
+	for (size_t i = idx + 1; JsonTape::tagOf(doc->tape[i]) != JsonTape::Tag::ArrayEnd; i = doc->next(i)) {
+		++res;
+	}
+	return res;
+}
+
+size_t TapeRef::arrSize(const std::string& key) const {
+	return get(key).arrSize();
+}
+
+TapeRef TapeRef::get(const std::string& key) const {
+	return get(split(key, "."));
+}
+
+TapeRef TapeRef::child(std::string_view key) const {
+	NodeType t = type();
+	if (t == NodeType::Object) {
+		// checking all members - for duplicate keys decoder keeps the last one
+		std::optional<size_t> res;
+		for (size_t i = idx + 1; JsonTape::tagOf(doc->tape[i]) != JsonTape::Tag::ObjectEnd; i = doc->next(i + 1)) {
+			if (doc->str(i) == key) {
+				res = i + 1;
+			}
+		}
+		if (res) {
+			return TapeRef(doc, *res);
+		}
+	}
+	else if (t == NodeType::Array) {
+		if (auto n = utils::getIdx(key); n) {
+			size_t i = idx + 1;
+			for (size_t cur = 0; JsonTape::tagOf(doc->tape[i]) != JsonTape::Tag::ArrayEnd; i = doc->next(i), ++cur) {
+				if (cur == n.value()) {
+					return TapeRef(doc, i);
+				}
+			}
+		}
+	}
+	throw std::out_of_range("couldn't get node");
+}
+
+// type mismatches throw the same exception as Json
+int64_t TapeRef::asInt() const {
+	if (type() != NodeType::Int) {
+		throw std::bad_variant_access();
+	}
+	return static_cast<int64_t>(doc->tape[idx + 1]);
+}
+
+double TapeRef::asFloat() const {
+	if (type() != NodeType::Float) {
+		throw std::bad_variant_access();
+	}
+	double res;
+	std::memcpy(&res, &doc->tape[idx + 1], sizeof(res));
+	return res;
+}
+
+bool TapeRef::asBool() const {
+	if (type() != NodeType::Bool) {
+		throw std::bad_variant_access();
+	}
+	return JsonTape::tagOf(doc->tape[idx]) == JsonTape::Tag::True;
+}
+
+std::string_view TapeRef::asStr() const {
+	if (type() != NodeType::String) {
+		throw std::bad_variant_access();
+	}
+	return doc->str(idx);
+}
@@ -0,0 +1,220 @@
+#pragma once
+#include "Json.hpp"
+
+namespace util::web::json {
+
+	class JsonTape;
+
+	// reference to a value inside JsonTape (valid while document is alive).
+	// Has the same read-only interface as Json, so consumers can switch between them
+	class TapeRef {
+	public:
+		TapeRef();
+
+		template<typename T>
+		T as() const;
+		template<typename T>
+		T as(const std::string& key) const;
+		template<typename T, StringVector Cont>
+		T as(const Cont& keys) const;
+
+		bool empty() const;
+		NodeType type() const;
+
+		std::vector<std::string> keys() const;
+		std::vector<std::string> keys(const std::string& key) const;
+		template<StringVector Cont>
+		std::vector<std::string> keys(const Cont& keys) const;
+
+		size_t arrSize() const;
+		size_t arrSize(const std::string& key) const;
+		template<StringVector Cont>
+		size_t arrSize(const Cont& keys) const;
+
+		// same path syntax as Json::get(): '.' delimiter and '[]' indexes
+		TapeRef get(const std::string& key) const;
+		template<StringVector Cont>
+		TapeRef get(const Cont& keys) const;
+	private:
+		friend class JsonTape;
+		TapeRef(const JsonTape* doc, size_t idx);
+		TapeRef child(std::string_view key) const;
+		int64_t asInt() const;
+		double asFloat() const;
+		bool asBool() const;
+		std::string_view asStr() const;
+
+		const JsonTape* doc = nullptr;
+		size_t idx = 0;
+	};
+
+	// compact read-only document: all values are laid out in one flat array of 64-bit words ("tape")
+	// in document order, and all strings are stored in one string buffer.
+	// Word is tag (high byte) + payload. Containers' opening words keep index of their closing word and
+	// number of elements, so lookups jump over subtrees without walking them;
+	// numbers take one extra word with raw value; strings (and keys) keep offset into string buffer.
+	// No per-node allocations - document is 2 vectors, which is several times smaller than Node tree
+	class JsonTape {
+	public:
+		enum class Tag : uint8_t {
+			Object = '{',
+			ObjectEnd = '}',
+			Array = '[',
+			ArrayEnd = ']',
+			String = '"',
+			Int = 'l',
+			Float = 'd',
+			True = 't',
+			False = 'f',
+			Null = 'n'
+		};
+
+		JsonTape();
+		// throws std::runtime_error/std::logic_error on invalid json, as JsonDecoder
+		JsonTape(std::string_view v);
+
+		template<typename T>
+		T as() const;
+		template<typename T>
+		T as(const std::string& key) const;
+		template<typename T, StringVector Cont>
+		T as(const Cont& keys) const;
+
+		bool empty() const;
+		NodeType type() const;
+
+		std::vector<std::string> keys() const;
+		std::vector<std::string> keys(const std::string& key) const;
+		template<StringVector Cont>
+		std::vector<std::string> keys(const Cont& keys) const;
+
+		size_t arrSize() const;
+		size_t arrSize(const std::string& key) const;
+		template<StringVector Cont>
+		size_t arrSize(const Cont& keys) const;
+
+		TapeRef root() const;
+		TapeRef get(const std::string& key) const;
+		template<StringVector Cont>
+		TapeRef get(const Cont& keys) const;
+
+		// bytes used by tape and string buffer
+		size_t footprint() const;
+	private:
+		friend class TapeRef;
+		class Builder;
+
+		static constexpr int TagShift = 56;
+		static constexpr uint64_t PayloadMask = (uint64_t(1) << TagShift) - 1;
+		// containers' payload: element count (saturated) in high bits, index of closing word in low bits
+		static constexpr int CountShift = 32;
+		static constexpr uint64_t MaxCount = (uint64_t(1) << (TagShift - CountShift)) - 1;
+
+		static inline Tag tagOf(uint64_t word) { return static_cast<Tag>(word >> TagShift); }
+		static inline uint64_t payloadOf(uint64_t word) { return word & PayloadMask; }
+		static inline uint64_t makeWord(Tag tag, uint64_t payload) { return (uint64_t(tag) << TagShift) | payload; }
+
+		// index of the word after value starting at 'idx'
+		size_t next(size_t idx) const;
+		std::string_view str(size_t idx) const;
+
+		std::vector<uint64_t> tape;
+		// each string is 4-byte length followed by its bytes
+		std::string strings;
+	};
+
+	template<typename T>
+	T TapeRef::as() const {
+		if constexpr (std::is_same_v<T, bool>) {
+			return asBool();
+		}
+		else if constexpr (std::is_same_v<T, Null>) {
+			if (type() != NodeType::Null) {
+				throw std::bad_variant_access();
+			}
+			return Null{};
+		}
+		else if constexpr (ValueStringType<T>) {
+			return T(asStr());
+		}
+		else if constexpr (std::is_integral_v<T>) {
+			return static_cast<T>(asInt());
+		}
+		else if constexpr (std::is_floating_point_v<T>) {
+			return static_cast<T>(asFloat());
+		}
+		else {
+			if (type() != NodeType::Array) {
+				throw std::logic_error("JSON: not an array node");
+			}
+			T res;
+			res.reserve(arrSize());
+			for (size_t i = idx + 1; JsonTape::tagOf(doc->tape[i]) != JsonTape::Tag::ArrayEnd; i = doc->next(i)) {
+				res.push_back(TapeRef(doc, i).as<typename T::value_type>());
+			}
+			return res;
+		}
+	}
+
+	template<typename T>
+	T TapeRef::as(const std::string& key) const {
+		TapeRef node = get(key);
+		return node.as<T>();
+	}
+
+	template<typename T, StringVector Cont>
+	T TapeRef::as(const Cont& keys) const {
+		TapeRef node = get(keys);
+		return node.as<T>();
+	}
+
+	template<StringVector Cont>
+	std::vector<std::string> TapeRef::keys(const Cont& keys) const {
+		return get(keys).keys();
+	}
+
+	template<StringVector Cont>
+	size_t TapeRef::arrSize(const Cont& keys) const {
+		return get(keys).arrSize();
+	}
+
+	template<StringVector Cont>
+	TapeRef TapeRef::get(const Cont& keys) const {
+		TapeRef cur = *this;
+		for (const auto& key : keys) {
+			cur = cur.child(std::string_view(key.data(), key.size()));
+		}
+		return cur;
+	}
+
+	template<typename T>
+	T JsonTape::as() const {
+		return root().as<T>();
+	}
+
+	template<typename T>
+	T JsonTape::as(const std::string& key) const {
+		return root().as<T>(key);
+	}
+
+	template<typename T, StringVector Cont>
+	T JsonTape::as(const Cont& keys) const {
+		return root().as<T>(keys);
+	}
+
+	template<StringVector Cont>
+	std::vector<std::string> JsonTape::keys(const Cont& keys) const {
+		return root().keys(keys);
+	}
+
+	template<StringVector Cont>
+	size_t JsonTape::arrSize(const Cont& keys) const {
+		return root().arrSize(keys);
+	}
+
+	template<StringVector Cont>
+	TapeRef JsonTape::get(const Cont& keys) const {
+		return root().get(keys);
+	}
+
+}
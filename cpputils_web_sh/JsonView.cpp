@@ -0,0 +1,214 @@
+#include "JsonView.hpp"
+#include "JsonSimd.hpp"
+#include <stdexcept>
+
+using namespace util::string;
+using namespace util::web::json;
+
+namespace {
+
+	// calls f(key, value) for members of object 'v' while f returns true
+	template<typename F>
+	void forEachMember(std::string_view v, F f) {
+		size_t pos = utils::skipSpaces(v, 1);
+		if (pos < v.size() && v[pos] == '}') {
+			return;
+		}
+		for (;;) {
+			if (pos >= v.size() || v[pos] != '"') {
+				throw std::runtime_error("invalid object node");
+			}
+			size_t keyEnd = utils::findStrEnd(v, pos + 1);
+			if (keyEnd == v.npos) {
+				throw std::runtime_error("invalid object node");
+			}
+			std::string_view key = v.substr(pos + 1, keyEnd - (pos + 1));
+			pos = utils::skipSpaces(v, keyEnd + 1);
+			if (pos >= v.size() || v[pos] != ':') {
+				throw std::runtime_error("invalid object node");
+			}
+			pos = utils::skipSpaces(v, pos + 1);
+			size_t valEnd = utils::skipValue(v, pos);
+			if (!f(key, v.substr(pos, valEnd - pos))) {
+				return;
+			}
+			pos = utils::skipSpaces(v, valEnd);
+			if (pos < v.size() && v[pos] == ',') {
+				pos = utils::skipSpaces(v, pos + 1);
+			}
+			else if (pos < v.size() && v[pos] == '}') {
+				return;
+			}
+			else {
+				throw std::runtime_error("invalid object node");
+			}
+		}
+	}
+
+	// key as decoder gives it: escape sequences are unescaped into 'buf'
+	std::string_view unescapeKey(std::string_view raw, std::string& buf) {
+		size_t esc = simd::findEscape(raw);
+		if (esc == raw.npos) {
+			return raw;
+		}
+		buf.resize(raw.size());
+		std::memcpy(buf.data(), raw.data(), esc);
+		buf.resize(esc + simd::unescapeStr(raw.substr(esc), buf.data() + esc));
+		return buf;
+	}
+
+	// calls f(value) for elements of array 'v' while f returns true
+	template<typename F>
+	void forEachElement(std::string_view v, F f) {
+		size_t pos = utils::skipSpaces(v, 1);
+		if (pos < v.size() && v[pos] == ']') {
+			return;
+		}
+		for (;;) {
+			size_t valEnd = utils::skipValue(v, pos);
+			if (!f(v.substr(pos, valEnd - pos))) {
+				return;
+			}
+			pos = utils::skipSpaces(v, valEnd);
+			if (pos < v.size() && v[pos] == ',') {
+				pos = utils::skipSpaces(v, pos + 1);
+			}
+			else if (pos < v.size() && v[pos] == ']') {
+				return;
+			}
+			else {
+				throw std::runtime_error("invalid array node");
+			}
+		}
+	}
+
+}
+
+JsonView::JsonView()
+	: v{}
+{
+
+}
+
+JsonView::JsonView(std::string_view v)
+	: v{ strip(v) }
+{
+
+}
+
+bool JsonView::empty() const {
+	return v.empty();
+}
+
+NodeType JsonView::type() const {
+	if (v.empty()) {
+		return NodeType::NoType;
+	}
+	switch (v.front()) {
+	case '{':
+		return NodeType::Object;
+	case '[':
+		return NodeType::Array;
+	case '"':
+		return NodeType::String;
+	case 't':
+	case 'f':
+		return NodeType::Bool;
+	case 'n':
+		return NodeType::Null;
+	default:
+		return (v.find_first_of(".eE") != v.npos) ? NodeType::Float : NodeType::Int;
+	}
+}
+
+std::vector<std::string> JsonView::keys() const {
+	if (type() != NodeType::Object) {
+		throw std::logic_error("JSON: not an object node");
+	}
+	std::vector<std::string> res;
+	std::string buf;
+	forEachMember(v, [&res, &buf](std::string_view key, std::string_view) {
+		res.emplace_back(unescapeKey(key, buf));
+		return true;
+	});
+	return res;
+}
+
+std::vector<std::string> JsonView::keys(const std::string& key) const {
+	return get(key).keys();
+}
+
+size_t JsonView::arrSize() const {
+	if (type() != NodeType::Array) {
+		throw std::logic_error("JSON: not an array node");
+	}
+	size_t res = 0;
+	forEachElement(v, [&res](std::string_view) {
+		++res;
+		return true;
+	});
+	return res;
+}
+
+size_t JsonView::arrSize(const std::string& key) const {
+	return get(key).arrSize();
+}
+
+std::string_view JsonView::asStrView() const {
+	// strings without escapes borrow memory of decoded text
+	Json json = JsonDecoder().decode(v, nullptr);
+	std::string_view res = json.as<std::string_view>();
+	if (res.data() < v.data() || res.data() > v.data() + v.size()) {
+		throw std::runtime_error("JSON: string with escapes can't be viewed");
+	}
+	return res;
+}
+
+JsonView JsonView::get(const std::string& key) const {
+	return get(split(key, "."));
+}
+
+JsonView JsonView::child(std::string_view key) const {
+	NodeType t = type();
+	if (t == NodeType::Object) {
+		return objChild(key);
+	}
+	else if (t == NodeType::Array) {
+		if (auto idx = utils::getIdx(key); idx) {
+			return arrChild(idx.value());
+		}
+	}
+	throw std::out_of_range("couldn't get node");
+}
+
+JsonView JsonView::objChild(std::string_view key) const {
+	std::optional<std::string_view> res;
+	std::string buf;
+	forEachMember(v, [&res, &buf, key](std::string_view curKey, std::string_view val) {
+		// checking all members - for duplicate keys decoder keeps the last one
+		if (unescapeKey(curKey, buf) == key) {
+			res = val;
+		}
+		return true;
+	});
+	if (!res) {
+		throw std::out_of_range("couldn't get node");
+	}
+	return JsonView(*res);
+}
+
+JsonView JsonView::arrChild(size_t idx) const {
+	std::optional<std::string_view> res;
+	size_t i = 0;
+	forEachElement(v, [&res, &i, idx](std::string_view val) {
+		if (i++ == idx) {
+			res = val;
+			return false;
+		}
+		return true;
+	});
+	if (!res) {
+		throw std::out_of_range("couldn't get node");
+	}
+	return JsonView(*res);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "Json.hpp"
+
+namespace util::web::json {
+
+	// lazy read-only view over json text.
+	// Nothing is decoded on construction: path lookups skip unneeded subtrees by matching brackets and quotes,
+	// and only values touched by as() are decoded into nodes.
+	// Viewed text should outlive the view. Invalid json is detected only inside touched parts.
+	class JsonView {
+	public:
+		JsonView();
+		JsonView(std::string_view v);
+
+		// std::string_view points into viewed text; throws std::runtime_error for strings with escapes,
+		// which can't be viewed without unescaping (read them as std::string)
+		template<typename T>
+		T as() const;
+		template<typename T>
+		T as(const std::string& key) const;
+		template<typename T, StringVector Cont>
+		T as(const Cont& keys) const;
+
+		bool empty() const;
+		// text of viewed value
+		inline std::string_view raw() const { return v; }
+		NodeType type() const;
+
+		std::vector<std::string> keys() const;
+		std::vector<std::string> keys(const std::string& key) const;
+		template<StringVector Cont>
+		std::vector<std::string> keys(const Cont& keys) const;
+
+		size_t arrSize() const;
+		size_t arrSize(const std::string& key) const;
+		template<StringVector Cont>
+		size_t arrSize(const Cont& keys) const;
+
+		// same path syntax as Json::get(): '.' delimiter and '[]' indexes
+		JsonView get(const std::string& key) const;
+		template<StringVector Cont>
+		JsonView get(const Cont& keys) const;
+	private:
+		JsonView child(std::string_view key) const;
+		JsonView objChild(std::string_view key) const;
+		JsonView arrChild(size_t idx) const;
+		std::string_view asStrView() const;
+		std::string_view v;
+	};
+
+	template<typename T>
+	T JsonView::as() const {
+		static_assert(!std::is_same_v<T, std::vector<std::string_view>>, "views would point into decoded temporary");
+		if constexpr (std::is_same_v<T, std::string_view>) {
+			return asStrView();
+		}
+		else {
+			Json json = JsonDecoder().decode(v);
+			return json.as<T>();
+		}
+	}
+
+	template<typename T>
+	T JsonView::as(const std::string& key) const {
+		return get(key).as<T>();
+	}
+
+	template<typename T, StringVector Cont>
+	T JsonView::as(const Cont& keys) const {
+		JsonView node = get(keys);
+		return node.as<T>();
+	}
+
+	template<StringVector Cont>
+	std::vector<std::string> JsonView::keys(const Cont& keys) const {
+		return get(keys).keys();
+	}
+
+	template<StringVector Cont>
+	size_t JsonView::arrSize(const Cont& keys) const {
+		return get(keys).arrSize();
+	}
+
+	template<StringVector Cont>
+	JsonView JsonView::get(const Cont& keys) const {
+		JsonView cur = *this;
+		for (const auto& key : keys) {
+			cur = cur.child(std::string_view(key.data(), key.size()));
+		}
+		return cur;
+	}
+
+}
@@ -0,0 +1,123 @@
+#include "JsonWriter.hpp"
+#include "Socket.hpp"
+#include <stdexcept>
+#include <format>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <vector>
+#include <algorithm>
+
+using namespace util::web::json;
+
+JsonWriter::~JsonWriter() {
+	;
+}
+
+void JsonWriter::writeChunks(std::span<std::string> chunks) {
+	for (auto& chunk : chunks) {
+		if (!chunk.empty()) {
+			write(chunk);
+		}
+	}
+}
+
+OstreamJsonWriter::OstreamJsonWriter(std::ostream& os)
+	: os{ os }
+{
+
+}
+
+void OstreamJsonWriter::write(std::string& chunk) {
+	os.write(chunk.data(), chunk.size());
+}
+
+FdJsonWriter::FdJsonWriter(int fd)
+	: fd{ fd }
+{
+
+}
+
+void FdJsonWriter::write(std::string& chunk) {
+	size_t offset = 0;
+	while (offset < chunk.size()) {
+		ssize_t nbytes = ::write(fd, chunk.data() + offset, chunk.size() - offset);
+		if (nbytes < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error(std::format("JSON: couldn't write to fd {}: {}", fd, strerror(errno)));
+		}
+		offset += nbytes;
+	}
+}
+
+void FdJsonWriter::writeChunks(std::span<std::string> chunks) {
+	std::vector<iovec> iov;
+	iov.reserve(chunks.size());
+	for (auto& chunk : chunks) {
+		if (!chunk.empty()) {
+			iov.push_back(iovec{ chunk.data(), chunk.size() });
+		}
+	}
+	size_t first = 0;
+	while (first < iov.size()) {
+		ssize_t nbytes = ::writev(fd, iov.data() + first, static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX)));
+		if (nbytes < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error(std::format("JSON: couldn't write to fd {}: {}", fd, strerror(errno)));
+		}
+		// skipping written chunks, the last one may be written partially
+		size_t n = static_cast<size_t>(nbytes);
+		while (first < iov.size() && n >= iov[first].iov_len) {
+			n -= iov[first].iov_len;
+			++first;
+		}
+		if (n) {
+			iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + n;
+			iov[first].iov_len -= n;
+		}
+	}
+}
+
+SocketBufferJsonWriter::SocketBufferJsonWriter(std::deque<inet::OutputSocketBuffer>& chain)
+	: chain{ chain }
+{
+
+}
+
+SocketBufferJsonWriter::SocketBufferJsonWriter(std::deque<inet::OutputSocketBuffer>& chain, const inet::ISocket& socket)
+	: chain{ chain }, socket{ &socket }
+{
+
+}
+
+void SocketBufferJsonWriter::write(std::string& chunk) {
+	if (chunk.empty()) {
+		return;
+	}
+	// taking chunk's memory instead of copying it
+	chain.emplace_back(std::move(chunk));
+	if (socket) {
+		flush();
+	}
+}
+
+void SocketBufferJsonWriter::flush() {
+	while (!chain.empty()) {
+		ssize_t nbytes = socket->write(chain.front());
+		if (chain.front().finished()) {
+			chain.pop_front();
+		}
+		else if (nbytes == -EAGAIN || nbytes > 0) {
+			// socket is full - the rest is sent by caller
+			return;
+		}
+		else {
+			throw std::runtime_error(std::format("JSON: couldn't write to socket {}: {}", socket->fd(), socket->strerr()));
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <ostream>
+#include <deque>
+#include <span>
+
+// Socket.hpp is needed only by SocketBufferJsonWriter users
+namespace inet {
+	class OutputSocketBuffer;
+	class ISocket;
+}
+
+namespace util::web::json {
+
+	// destination of JsonEncoder's output chunks (see JsonEncoder::encode(const Json&, JsonWriter&))
+	class JsonWriter {
+	public:
+		virtual ~JsonWriter();
+		// writer may take contents of 'chunk' - encoder clears it after the call anyway
+		virtual void write(std::string& chunk) = 0;
+		// consecutive chunks (f.e. buffers of JsonEncoder's threads); by default each non-empty one is passed to write()
+		virtual void writeChunks(std::span<std::string> chunks);
+	};
+
+	class OstreamJsonWriter : public JsonWriter {
+	public:
+		OstreamJsonWriter(std::ostream& os);
+		void write(std::string& chunk) override;
+	private:
+		std::ostream& os;
+	};
+
+	// blocking file descriptor (file, pipe); throws std::runtime_error on write errors
+	class FdJsonWriter : public JsonWriter {
+	public:
+		FdJsonWriter(int fd);
+		void write(std::string& chunk) override;
+		// by one writev() (or a few, if there are more than IOV_MAX chunks or write is partial)
+		void writeChunks(std::span<std::string> chunks) override;
+	private:
+		int fd;
+	};
+
+	// every chunk becomes a new segment at the end of 'chain'.
+	// Without socket nothing is sent while encoding: the whole document piles up in chain, which caller sends later.
+	// With socket, segments are written from the front of chain after every chunk, and sent ones are removed,
+	// so only what socket couldn't take yet (EAGAIN) stays in memory and is left in chain for caller to send.
+	// Throws std::runtime_error if socket is closed or fails
+	class SocketBufferJsonWriter : public JsonWriter {
+	public:
+		SocketBufferJsonWriter(std::deque<inet::OutputSocketBuffer>& chain);
+		SocketBufferJsonWriter(std::deque<inet::OutputSocketBuffer>& chain, const inet::ISocket& socket);
+		void write(std::string& chunk) override;
+	private:
+		void flush();
+		std::deque<inet::OutputSocketBuffer>& chain;
+		const inet::ISocket* socket = nullptr;
+	};
+
+}
@@ -0,0 +1,43 @@
+#include "MappedFile.hpp"
+#include <stdexcept>
+#include <format>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace util::web::json;
+
+MappedFile::MappedFile(const std::string& path, Access access) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error(std::format("couldn't open file {}: {}", path, strerror(errno)));
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		int err = errno;
+		::close(fd);
+		throw std::runtime_error(std::format("couldn't stat file {}: {}", path, strerror(err)));
+	}
+	_size = static_cast<size_t>(st.st_size);
+	// empty mappings are not allowed
+	if (_size == 0) {
+		::close(fd);
+		return;
+	}
+	void* p = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// mapping stays valid after descriptor is closed
+	::close(fd);
+	if (p == MAP_FAILED) {
+		throw std::runtime_error(std::format("couldn't map file {}: {}", path, strerror(errno)));
+	}
+	madvise(p, _size, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+	_data = static_cast<const char*>(p);
+}
+
+MappedFile::~MappedFile() {
+	if (_data) {
+		munmap(const_cast<char*>(_data), _size);
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace util::web::json {
+
+	// read-only memory mapping of whole file. Pages are loaded by kernel on access, so nothing is copied to user memory
+	class MappedFile {
+	public:
+		// hint for kernel's read-ahead
+		enum class Access {
+			Sequential,
+			Random
+		};
+		// throws std::runtime_error if file can't be opened or mapped
+		MappedFile(const std::string& path, Access access = Access::Sequential);
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		inline std::string_view view() const { return std::string_view(_data, _size); }
+		inline const char* data() const { return _data; }
+		inline size_t size() const { return _size; }
+	private:
+		const char* _data = nullptr;
+		size_t _size = 0;
+	};
+
+}
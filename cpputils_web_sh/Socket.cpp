@@ -34,14 +34,28 @@ void InputSocketBuffer::realloc() {
 	realloc(std::min(MaxCapacity, std::max((size_t)0, (_capacity + MinSizeAvail) * 2)));
 }
 
+void InputSocketBuffer::detach(size_t keep) {
+	if (_data.use_count() > 1) {
+		std::shared_ptr<uint8_t[]> newData(new uint8_t[_capacity]);
+		memcpy(newData.get(), _data.get() + (_size - keep), keep);
+		_data = newData;
+	}
+}
+
 void InputSocketBuffer::clear() {
+	detach(0);
 	_size = 0;
 }
 
 // clears n bytes and moves rest of bytes to the beginning of the buffer
 void InputSocketBuffer::clear(size_t n) {
 	assert(_size >= n);
-	memmove(_data.get(), _data.get() + n, _size - n);
+	if (_data.use_count() > 1) {
+		detach(_size - n);
+	}
+	else {
+		memmove(_data.get(), _data.get() + n, _size - n);
+	}
 	_size = _size - n;
 }
 
@@ -22,7 +22,12 @@ namespace inet {
 		template<typename ReadFT, typename ArgT>
 		ssize_t read(ReadFT readF, ArgT fd);
 		std::span<uint8_t> get();
+		// memory of data, which can be shared with objects referencing it (f.e. json decoded without copying strings).
+		// While it is shared, buffer is copied before it is overwritten
+		inline std::shared_ptr<const uint8_t[]> storage() const { return _data; }
 	private:
+		// gives buffer new memory, if current one is shared
+		void detach(size_t keep);
 		std::span<uint8_t> getTail();
 		void realloc(size_t newCap);
 		void realloc();
@@ -3,6 +3,9 @@
 using namespace std;
 using namespace util::web::json;
 
+// "obj 3" fixture: array of 5 pretty-printed objects (7.5 KB)
+static const std::string obj3Doc = "[\r\n  {\r\n    \"_id\": \"654ce772b85bedd6d8898415\",\r\n    \"index\": 0,\r\n    \"guid\": \"e713b670-1d09-4df7-8512-d222ea1f642b\",\r\n    \"isActive\": true,\r\n    \"balance\": \"$3,952.26\",\r\n    \"picture\": \"http:\/\/placehold.it\/32x32\",\r\n    \"age\": 39,\r\n    \"eyeColor\": \"green\",\r\n    \"name\": \"Robbie Heath\",\r\n    \"gender\": \"female\",\r\n    \"company\": \"UNEEQ\",\r\n    \"email\": \"robbieheath@uneeq.com\",\r\n    \"phone\": \"+1 (946) 500-3256\",\r\n    \"address\": \"238 Jefferson Street, Barrelville, Louisiana, 9460\",\r\n    \"about\": \"Cupidatat eu irure officia cillum cillum esse labore voluptate irure quis ullamco dolore velit ad. Sit labore elit eiusmod quis tempor pariatur et cillum. Id labore ex consectetur culpa aliquip labore commodo exercitation ipsum reprehenderit enim minim deserunt occaecat. Anim ad culpa cillum adipisicing laborum est id adipisicing ea culpa. Officia adipisicing anim consectetur qui veniam amet laborum tempor laboris. Nisi dolore sint mollit incididunt culpa fugiat proident et cillum.\\r\\n\",\r\n    \"registered\": \"2015-03-05T12:35:44 -03:00\",\r\n    \"latitude\": -69.053469,\r\n    \"longitude\": -177.473446,\r\n    \"tags\": [\r\n      \"incididunt\",\r\n      \"nostrud\",\r\n      \"Lorem\",\r\n      \"nisi\",\r\n      \"ipsum\",\r\n      \"reprehenderit\",\r\n      \"irure\"\r\n    ],\r\n    \"friends\": [\r\n      {\r\n        \"id\": 0,\r\n        \"name\": \"Sheryl Farrell\"\r\n      },\r\n      {\r\n        \"id\": 1,\r\n        \"name\": \"Ochoa Tillman\"\r\n      },\r\n      {\r\n        \"id\": 2,\r\n        \"name\": \"Richmond Davidson\"\r\n      }\r\n    ],\r\n    \"greeting\": \"Hello, Robbie Heath! You have 10 unread messages.\",\r\n    \"favoriteFruit\": \"strawberry\"\r\n  },\r\n  {\r\n    \"_id\": \"654ce772b53f0f535c575c60\",\r\n    \"index\": 1,\r\n    \"guid\": \"e72b7ddd-7020-4753-85a9-92e56b4cd5f6\",\r\n    \"isActive\": true,\r\n    \"balance\": \"$3,427.31\",\r\n    \"picture\": \"http:\/\/placehold.it\/32x32\",\r\n    \"age\": 31,\r\n    \"eyeColor\": \"green\",\r\n    \"name\": \"Burton Booker\",\r\n    \"gender\": \"male\",\r\n    \"company\": \"IMKAN\",\r\n    \"email\": \"burtonbooker@imkan.com\",\r\n    \"phone\": \"+1 (983) 412-3627\",\r\n    \"address\": \"430 Eldert Street, Caln, Iowa, 8751\",\r\n    \"about\": \"Dolor est nulla sit nostrud velit adipisicing officia laborum. Qui sunt laboris aliqua proident est non tempor est et. Labore fugiat ad duis dolore veniam exercitation exercitation Lorem nostrud irure amet ipsum magna. Enim officia nostrud adipisicing tempor qui ex adipisicing elit mollit dolor officia in. Veniam ad esse ea nostrud Lorem ea commodo ad.\\r\\n\",\r\n    \"registered\": \"2015-11-14T07:02:52 -03:00\",\r\n    \"latitude\": 16.4488,\r\n    \"longitude\": -41.481124,\r\n    \"tags\": [\r\n      \"aliqua\",\r\n      \"incididunt\",\r\n      \"laborum\",\r\n      \"eiusmod\",\r\n      \"consectetur\",\r\n      \"ad\",\r\n      \"reprehenderit\"\r\n    ],\r\n    \"friends\": [\r\n      {\r\n        \"id\": 0,\r\n        \"name\": \"Holcomb Dillon\"\r\n      },\r\n      {\r\n        \"id\": 1,\r\n        \"name\": \"Alicia Kim\"\r\n      },\r\n      {\r\n        \"id\": 2,\r\n        \"name\": \"Estrada Church\"\r\n      }\r\n    ],\r\n    \"greeting\": \"Hello, Burton Booker! You have 9 unread messages.\",\r\n    \"favoriteFruit\": \"strawberry\"\r\n  },\r\n  {\r\n    \"_id\": \"654ce7728785d91c086ca42c\",\r\n    \"index\": 2,\r\n    \"guid\": \"8709bb58-68d2-475a-b4de-d888bd240ba5\",\r\n    \"isActive\": false,\r\n    \"balance\": \"$1,023.35\",\r\n    \"picture\": \"http:\/\/placehold.it\/32x32\",\r\n    \"age\": 37,\r\n    \"eyeColor\": \"green\",\r\n    \"name\": \"Rodgers Calderon\",\r\n    \"gender\": \"male\",\r\n    \"company\": \"WATERBABY\",\r\n    \"email\": \"rodgerscalderon@waterbaby.com\",\r\n    \"phone\": \"+1 (896) 472-3154\",\r\n    \"address\": \"918 Lafayette Avenue, Marne, Mississippi, 6478\",\r\n    \"about\": \"Tempor aliqua consectetur aliquip amet. Fugiat dolore culpa pariatur minim ex laboris. Et nisi anim ea occaecat eiusmod do exercitation commodo. Irure ipsum sit labore ex ipsum ad proident culpa minim deserunt consectetur cupidatat aliqua magna. Fugiat enim sit elit fugiat. Duis velit nulla sint incididunt deserunt nisi.\\r\\n\",\r\n    \"registered\": \"2015-11-26T06:29:23 -03:00\",\r\n    \"latitude\": 86.526226,\r\n    \"longitude\": 141.964954,\r\n    \"tags\": [\r\n      \"ex\",\r\n      \"ut\",\r\n      \"minim\",\r\n      \"nisi\",\r\n      \"excepteur\",\r\n      \"est\",\r\n      \"qui\"\r\n    ],\r\n    \"friends\": [\r\n      {\r\n        \"id\": 0,\r\n        \"name\": \"Garza Suarez\"\r\n      },\r\n      {\r\n        \"id\": 1,\r\n        \"name\": \"Thornton Powers\"\r\n      },\r\n      {\r\n        \"id\": 2,\r\n        \"name\": \"Grimes Noel\"\r\n      }\r\n    ],\r\n    \"greeting\": \"Hello, Rodgers Calderon! You have 7 unread messages.\",\r\n    \"favoriteFruit\": \"strawberry\"\r\n  },\r\n  {\r\n    \"_id\": \"654ce7722576677f9cc2a61a\",\r\n    \"index\": 3,\r\n    \"guid\": \"ae224cf6-65e2-4b48-a00e-bf7bbdf280c9\",\r\n    \"isActive\": false,\r\n    \"balance\": \"$3,949.16\",\r\n    \"picture\": \"http:\/\/placehold.it\/32x32\",\r\n    \"age\": 31,\r\n    \"eyeColor\": \"brown\",\r\n    \"name\": \"Cecilia Abbott\",\r\n    \"gender\": \"female\",\r\n    \"company\": \"INTRADISK\",\r\n    \"email\": \"ceciliaabbott@intradisk.com\",\r\n    \"phone\": \"+1 (979) 491-2521\",\r\n    \"address\": \"207 Olive Street, Cresaptown, Hawaii, 5504\",\r\n    \"about\": \"Sint consectetur Lorem labore voluptate ex sit non veniam veniam in. Reprehenderit eu duis culpa et nisi fugiat irure. Qui cillum veniam exercitation esse culpa fugiat labore minim sunt occaecat consectetur aliquip ullamco. Culpa adipisicing aute cillum amet enim do do aliquip voluptate adipisicing proident. Minim esse sunt incididunt aliqua Lorem ipsum cillum proident consequat ad quis do reprehenderit dolor. Consectetur incididunt magna eu Lorem laborum consectetur Lorem.\\r\\n\",\r\n    \"registered\": \"2016-02-05T10:48:04 -03:00\",\r\n    \"latitude\": -75.995765,\r\n    \"longitude\": -91.173087,\r\n    \"tags\": [\r\n      \"et\",\r\n      \"ad\",\r\n      \"reprehenderit\",\r\n      \"dolor\",\r\n      \"in\",\r\n      \"adipisicing\",\r\n      \"amet\"\r\n    ],\r\n    \"friends\": [\r\n      {\r\n        \"id\": 0,\r\n        \"name\": \"Lakisha Bond\"\r\n      },\r\n      {\r\n        \"id\": 1,\r\n        \"name\": \"Mariana Hyde\"\r\n      },\r\n      {\r\n        \"id\": 2,\r\n        \"name\": \"Randolph Fischer\"\r\n      }\r\n    ],\r\n    \"greeting\": \"Hello, Cecilia Abbott! You have 6 unread messages.\",\r\n    \"favoriteFruit\": \"strawberry\"\r\n  },\r\n  {\r\n    \"_id\": \"654ce772191ae5f640472f4b\",\r\n    \"index\": 4,\r\n    \"guid\": \"83318bab-d9d6-49e3-9d76-861cbba4b982\",\r\n    \"isActive\": false,\r\n    \"balance\": \"$2,967.04\",\r\n    \"picture\": \"http:\/\/placehold.it\/32x32\",\r\n    \"age\": 31,\r\n    \"eyeColor\": \"green\",\r\n    \"name\": \"Juliette Everett\",\r\n    \"gender\": \"female\",\r\n    \"company\": \"QUILK\",\r\n    \"email\": \"julietteeverett@quilk.com\",\r\n    \"phone\": \"+1 (873) 522-3495\",\r\n    \"address\": \"415 Vermont Street, Hollins, South Carolina, 9163\",\r\n    \"about\": \"Anim enim aliqua enim pariatur adipisicing ea ipsum voluptate magna non. Voluptate officia deserunt veniam incididunt esse dolor nulla deserunt mollit. Irure tempor aute qui irure mollit est incididunt quis elit anim exercitation. Commodo Lorem aliquip ex proident non elit excepteur do ex officia enim enim reprehenderit quis. Mollit pariatur sunt dolore sit irure aliquip irure aute. Excepteur in quis do sint sunt est mollit tempor id mollit ad.\\r\\n\",\r\n    \"registered\": \"2018-01-04T04:47:10 -03:00\",\r\n    \"latitude\": 56.56465,\r\n    \"longitude\": 53.958798,\r\n    \"tags\": [\r\n      \"ipsum\",\r\n      \"fugiat\",\r\n      \"qui\",\r\n      \"Lorem\",\r\n      \"et\",\r\n      \"Lorem\",\r\n      \"exercitation\"\r\n    ],\r\n    \"friends\": [\r\n      {\r\n        \"id\": 0,\r\n        \"name\": \"King Johnson\"\r\n      },\r\n      {\r\n        \"id\": 1,\r\n        \"name\": \"Dickson Yang\"\r\n      },\r\n      {\r\n        \"id\": 2,\r\n        \"name\": \"Ortega Gould\"\r\n      }\r\n    ],\r\n    \"greeting\": \"Hello, Juliette Everett! You have 1 unread messages.\",\r\n    \"favoriteFruit\": \"apple\"\r\n  }\r\n]";
+
 void testJsonDecode() {
 	cout << format("{:-^40}\n", "Testing json decoding");
 	// integer
@@ -149,7 +152,7 @@ void testJsonDecode() {
 	}
 	// obj 3
 	{
-		std::string si = "[\r\n  {\r\n    \"_id\": \"654ce772b85bedd6d8898415\",\r\n    \"index\": 0,\r\n    \"guid\": \"e713b670-1d09-4df7-8512-d222ea1f642b\",\r\n    \"isActive\": true,\r\n    \"balance\": \"$3,952.26\",\r\n    \"picture\": \"http:\/\/placehold.it\/32x32\",\r\n    \"age\": 39,\r\n    \"eyeColor\": \"green\",\r\n    \"name\": \"Robbie Heath\",\r\n    \"gender\": \"female\",\r\n    \"company\": \"UNEEQ\",\r\n    \"email\": \"robbieheath@uneeq.com\",\r\n    \"phone\": \"+1 (946) 500-3256\",\r\n    \"address\": \"238 Jefferson Street, Barrelville, Louisiana, 9460\",\r\n    \"about\": \"Cupidatat eu irure officia cillum cillum esse labore voluptate irure quis ullamco dolore velit ad. Sit labore elit eiusmod quis tempor pariatur et cillum. Id labore ex consectetur culpa aliquip labore commodo exercitation ipsum reprehenderit enim minim deserunt occaecat. Anim ad culpa cillum adipisicing laborum est id adipisicing ea culpa. Officia adipisicing anim consectetur qui veniam amet laborum tempor laboris. Nisi dolore sint mollit incididunt culpa fugiat proident et cillum.\\r\\n\",\r\n    \"registered\": \"2015-03-05T12:35:44 -03:00\",\r\n    \"latitude\": -69.053469,\r\n    \"longitude\": -177.473446,\r\n    \"tags\": [\r\n      \"incididunt\",\r\n      \"nostrud\",\r\n      \"Lorem\",\r\n      \"nisi\",\r\n      \"ipsum\",\r\n      \"reprehenderit\",\r\n      \"irure\"\r\n    ],\r\n    \"friends\": [\r\n      {\r\n        \"id\": 0,\r\n        \"name\": \"Sheryl Farrell\"\r\n      },\r\n      {\r\n        \"id\": 1,\r\n        \"name\": \"Ochoa Tillman\"\r\n      },\r\n      {\r\n        \"id\": 2,\r\n        \"name\": \"Richmond Davidson\"\r\n      }\r\n    ],\r\n    \"greeting\": \"Hello, Robbie Heath! You have 10 unread messages.\",\r\n    \"favoriteFruit\": \"strawberry\"\r\n  },\r\n  {\r\n    \"_id\": \"654ce772b53f0f535c575c60\",\r\n    \"index\": 1,\r\n    \"guid\": \"e72b7ddd-7020-4753-85a9-92e56b4cd5f6\",\r\n    \"isActive\": true,\r\n    \"balance\": \"$3,427.31\",\r\n    \"picture\": \"http:\/\/placehold.it\/32x32\",\r\n    \"age\": 31,\r\n    \"eyeColor\": \"green\",\r\n    \"name\": \"Burton Booker\",\r\n    \"gender\": \"male\",\r\n    \"company\": \"IMKAN\",\r\n    \"email\": \"burtonbooker@imkan.com\",\r\n    \"phone\": \"+1 (983) 412-3627\",\r\n    \"address\": \"430 Eldert Street, Caln, Iowa, 8751\",\r\n    \"about\": \"Dolor est nulla sit nostrud velit adipisicing officia laborum. Qui sunt laboris aliqua proident est non tempor est et. Labore fugiat ad duis dolore veniam exercitation exercitation Lorem nostrud irure amet ipsum magna. Enim officia nostrud adipisicing tempor qui ex adipisicing elit mollit dolor officia in. Veniam ad esse ea nostrud Lorem ea commodo ad.\\r\\n\",\r\n    \"registered\": \"2015-11-14T07:02:52 -03:00\",\r\n    \"latitude\": 16.4488,\r\n    \"longitude\": -41.481124,\r\n    \"tags\": [\r\n      \"aliqua\",\r\n      \"incididunt\",\r\n      \"laborum\",\r\n      \"eiusmod\",\r\n      \"consectetur\",\r\n      \"ad\",\r\n      \"reprehenderit\"\r\n    ],\r\n    \"friends\": [\r\n      {\r\n        \"id\": 0,\r\n        \"name\": \"Holcomb Dillon\"\r\n      },\r\n      {\r\n        \"id\": 1,\r\n        \"name\": \"Alicia Kim\"\r\n      },\r\n      {\r\n        \"id\": 2,\r\n        \"name\": \"Estrada Church\"\r\n      }\r\n    ],\r\n    \"greeting\": \"Hello, Burton Booker! You have 9 unread messages.\",\r\n    \"favoriteFruit\": \"strawberry\"\r\n  },\r\n  {\r\n    \"_id\": \"654ce7728785d91c086ca42c\",\r\n    \"index\": 2,\r\n    \"guid\": \"8709bb58-68d2-475a-b4de-d888bd240ba5\",\r\n    \"isActive\": false,\r\n    \"balance\": \"$1,023.35\",\r\n    \"picture\": \"http:\/\/placehold.it\/32x32\",\r\n    \"age\": 37,\r\n    \"eyeColor\": \"green\",\r\n    \"name\": \"Rodgers Calderon\",\r\n    \"gender\": \"male\",\r\n    \"company\": \"WATERBABY\",\r\n    \"email\": \"rodgerscalderon@waterbaby.com\",\r\n    \"phone\": \"+1 (896) 472-3154\",\r\n    \"address\": \"918 Lafayette Avenue, Marne, Mississippi, 6478\",\r\n    \"about\": \"Tempor aliqua consectetur aliquip amet. Fugiat dolore culpa pariatur minim ex laboris. Et nisi anim ea occaecat eiusmod do exercitation commodo. Irure ipsum sit labore ex ipsum ad proident culpa minim deserunt consectetur cupidatat aliqua magna. Fugiat enim sit elit fugiat. Duis velit nulla sint incididunt deserunt nisi.\\r\\n\",\r\n    \"registered\": \"2015-11-26T06:29:23 -03:00\",\r\n    \"latitude\": 86.526226,\r\n    \"longitude\": 141.964954,\r\n    \"tags\": [\r\n      \"ex\",\r\n      \"ut\",\r\n      \"minim\",\r\n      \"nisi\",\r\n      \"excepteur\",\r\n      \"est\",\r\n      \"qui\"\r\n    ],\r\n    \"friends\": [\r\n      {\r\n        \"id\": 0,\r\n        \"name\": \"Garza Suarez\"\r\n      },\r\n      {\r\n        \"id\": 1,\r\n        \"name\": \"Thornton Powers\"\r\n      },\r\n      {\r\n        \"id\": 2,\r\n        \"name\": \"Grimes Noel\"\r\n      }\r\n    ],\r\n    \"greeting\": \"Hello, Rodgers Calderon! You have 7 unread messages.\",\r\n    \"favoriteFruit\": \"strawberry\"\r\n  },\r\n  {\r\n    \"_id\": \"654ce7722576677f9cc2a61a\",\r\n    \"index\": 3,\r\n    \"guid\": \"ae224cf6-65e2-4b48-a00e-bf7bbdf280c9\",\r\n    \"isActive\": false,\r\n    \"balance\": \"$3,949.16\",\r\n    \"picture\": \"http:\/\/placehold.it\/32x32\",\r\n    \"age\": 31,\r\n    \"eyeColor\": \"brown\",\r\n    \"name\": \"Cecilia Abbott\",\r\n    \"gender\": \"female\",\r\n    \"company\": \"INTRADISK\",\r\n    \"email\": \"ceciliaabbott@intradisk.com\",\r\n    \"phone\": \"+1 (979) 491-2521\",\r\n    \"address\": \"207 Olive Street, Cresaptown, Hawaii, 5504\",\r\n    \"about\": \"Sint consectetur Lorem labore voluptate ex sit non veniam veniam in. Reprehenderit eu duis culpa et nisi fugiat irure. Qui cillum veniam exercitation esse culpa fugiat labore minim sunt occaecat consectetur aliquip ullamco. Culpa adipisicing aute cillum amet enim do do aliquip voluptate adipisicing proident. Minim esse sunt incididunt aliqua Lorem ipsum cillum proident consequat ad quis do reprehenderit dolor. Consectetur incididunt magna eu Lorem laborum consectetur Lorem.\\r\\n\",\r\n    \"registered\": \"2016-02-05T10:48:04 -03:00\",\r\n    \"latitude\": -75.995765,\r\n    \"longitude\": -91.173087,\r\n    \"tags\": [\r\n      \"et\",\r\n      \"ad\",\r\n      \"reprehenderit\",\r\n      \"dolor\",\r\n      \"in\",\r\n      \"adipisicing\",\r\n      \"amet\"\r\n    ],\r\n    \"friends\": [\r\n      {\r\n        \"id\": 0,\r\n        \"name\": \"Lakisha Bond\"\r\n      },\r\n      {\r\n        \"id\": 1,\r\n        \"name\": \"Mariana Hyde\"\r\n      },\r\n      {\r\n        \"id\": 2,\r\n        \"name\": \"Randolph Fischer\"\r\n      }\r\n    ],\r\n    \"greeting\": \"Hello, Cecilia Abbott! You have 6 unread messages.\",\r\n    \"favoriteFruit\": \"strawberry\"\r\n  },\r\n  {\r\n    \"_id\": \"654ce772191ae5f640472f4b\",\r\n    \"index\": 4,\r\n    \"guid\": \"83318bab-d9d6-49e3-9d76-861cbba4b982\",\r\n    \"isActive\": false,\r\n    \"balance\": \"$2,967.04\",\r\n    \"picture\": \"http:\/\/placehold.it\/32x32\",\r\n    \"age\": 31,\r\n    \"eyeColor\": \"green\",\r\n    \"name\": \"Juliette Everett\",\r\n    \"gender\": \"female\",\r\n    \"company\": \"QUILK\",\r\n    \"email\": \"julietteeverett@quilk.com\",\r\n    \"phone\": \"+1 (873) 522-3495\",\r\n    \"address\": \"415 Vermont Street, Hollins, South Carolina, 9163\",\r\n    \"about\": \"Anim enim aliqua enim pariatur adipisicing ea ipsum voluptate magna non. Voluptate officia deserunt veniam incididunt esse dolor nulla deserunt mollit. Irure tempor aute qui irure mollit est incididunt quis elit anim exercitation. Commodo Lorem aliquip ex proident non elit excepteur do ex officia enim enim reprehenderit quis. Mollit pariatur sunt dolore sit irure aliquip irure aute. Excepteur in quis do sint sunt est mollit tempor id mollit ad.\\r\\n\",\r\n    \"registered\": \"2018-01-04T04:47:10 -03:00\",\r\n    \"latitude\": 56.56465,\r\n    \"longitude\": 53.958798,\r\n    \"tags\": [\r\n      \"ipsum\",\r\n      \"fugiat\",\r\n      \"qui\",\r\n      \"Lorem\",\r\n      \"et\",\r\n      \"Lorem\",\r\n      \"exercitation\"\r\n    ],\r\n    \"friends\": [\r\n      {\r\n        \"id\": 0,\r\n        \"name\": \"King Johnson\"\r\n      },\r\n      {\r\n        \"id\": 1,\r\n        \"name\": \"Dickson Yang\"\r\n      },\r\n      {\r\n        \"id\": 2,\r\n        \"name\": \"Ortega Gould\"\r\n      }\r\n    ],\r\n    \"greeting\": \"Hello, Juliette Everett! You have 1 unread messages.\",\r\n    \"favoriteFruit\": \"apple\"\r\n  }\r\n]";
+		std::string si = obj3Doc;
 		//std::string si = "[{\"1\":1},{\"2\":2}]";
 		JsonDecoder jd1;
 		auto before = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
@@ -163,6 +166,30 @@ void testJsonDecode() {
 		JsonEncoder je1;
 		std::string se = je1.encode(j1);
 	}
+	// whitespaces, empty containers, exponents
+	{
+		std::string si = " { \"a\" : [ ] , \"b\":{ }, \"c\" :[ 1e2 , -2.5E-1, \"x\\\"y\" ] }\n";
+		JsonDecoder jd1;
+		auto j1 = jd1.decode(si);
+		assert(j1.arrSize("a") == 0);
+		assert(j1.keys("b").empty());
+		assert(j1.as<double>("c.[0]") == 100.0);
+		assert(j1.as<double>("c.[1]") == -0.25);
+		assert(j1.as<std::string>("c.[2]") == "x\"y");
+	}
+	// invalid input
+	{
+		for (std::string si : { "[1,2", "{\"a\":1,}", "{\"a\" 1}", "[1] 2", "\"abc", "tru" }) {
+			bool thrown = false;
+			try {
+				JsonDecoder().decode(si);
+			}
+			catch (const std::exception&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+	}
 	{
 		// bugs
 		/*std::string si = "{\"0\":0,\"1\":1}";
@@ -173,6 +200,1741 @@ void testJsonDecode() {
 	return;
 }
 
+// array of 'width' objects, each wrapped into 'depth' levels of nested objects
+static std::string makeJsonDoc(size_t width, size_t depth) {
+	std::string res = "[";
+	for (size_t i = 0; i < width; ++i) {
+		std::string elem = format("{{\"id\":{0},\"name\":\"item {0}\",\"ratio\":{0}.25,\"active\":true}}", i);
+		for (size_t lvl = 0; lvl < depth; ++lvl) {
+			elem = format("{{\"lvl\":{},\"child\":{},\"tags\":[1,2,\"x\"]}}", lvl, elem);
+		}
+		res.append(i ? "," : "").append(elem);
+	}
+	res.append("]");
+	return res;
+}
+
+template<typename F>
+static int64_t measureMcs(F f, size_t iterations) {
+	auto before = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	for (size_t i = 0; i < iterations; ++i) {
+		f();
+	}
+	auto after = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	return (after - before) / (int64_t)iterations;
+}
+
+// previous decoder for comparison: every nesting level is split by smartSplit and its pieces are decoded again
+static Node splitDecode(std::string_view v) {
+	std::string_view body = util::string::strip(v);
+	switch (check::getType(body)) {
+	case NodeType::Object: {
+		ObjNode obj;
+		for (std::string_view elem : utils::smartSplit(util::string::strip(body.substr(1, body.size() - 2)), ',')) {
+			auto pair = utils::smartSplit(util::string::strip(elem), ':');
+			if (pair.size() != 2 || !check::isStr(pair[0])) {
+				throw std::runtime_error("invalid object node");
+			}
+			obj.cont().insert_or_assign(Str(pair[0].substr(1, pair[0].size() - 2)), splitDecode(pair[1]));
+		}
+		return obj;
+	}
+	case NodeType::Array: {
+		ArrNode arr;
+		for (std::string_view elem : utils::smartSplit(util::string::strip(body.substr(1, body.size() - 2)), ',')) {
+			arr.cont().push_back(splitDecode(elem));
+		}
+		return arr;
+	}
+	case NodeType::String:
+		return ValNode(std::string(body.substr(1, body.size() - 2)));
+	case NodeType::Bool:
+		return ValNode(body == "true");
+	case NodeType::Null:
+		return ValNode();
+	default: {
+		size_t pos = 0;
+		auto num = utils::parseNumber(body, pos);
+		return std::holds_alternative<int64_t>(num) ? ValNode(std::get<int64_t>(num)) : ValNode(std::get<double>(num));
+	}
+	}
+}
+
+void testJsonDecodeBench() {
+	cout << format("{:-^40}\n", "Json decoding benchmark");
+	std::vector<std::pair<std::string, std::string>> docs = { { "obj 3", obj3Doc } };
+	for (auto [width, depth] : { std::pair<size_t, size_t>{ 10000, 0 }, { 500, 10 }, { 50, 100 } }) {
+		docs.emplace_back(format("width {}, depth {}", width, depth), makeJsonDoc(width, depth));
+	}
+	for (const auto& [name, si] : docs) {
+		JsonDecoder jd1;
+		Json j1;
+		auto mcs = measureMcs([&]() { j1 = jd1.decode(si); }, 5);
+		Json j2;
+		auto splitMcs = measureMcs([&]() { j2 = Json(splitDecode(si)); }, 5);
+		// split decoder keeps strings escaped, so compare shape only
+		assert(j1.arrSize(std::vector<std::string>{}) == j2.arrSize(std::vector<std::string>{}));
+		cout << format("{}, {} bytes: {}mcs (split decoder {}mcs)\n", name, si.size(), mcs, splitMcs);
+	}
+}
+
+// byte-by-byte reference for structural index
+static std::vector<uint32_t> structuralIndexRef(std::string_view v) {
+	std::vector<uint32_t> res;
+	bool inString = false;
+	bool escaped = false;
+	for (size_t i = 0; i < v.size(); ++i) {
+		bool isEscaped = escaped;
+		escaped = false;
+		if (v[i] == '\\' && !isEscaped) {
+			escaped = true;
+		}
+		else if (v[i] == '"') {
+			if (!isEscaped) {
+				res.push_back((uint32_t)i);
+				inString = !inString;
+			}
+		}
+		else if (!inString && std::string_view("{}[]:,").find(v[i]) != std::string_view::npos) {
+			res.push_back((uint32_t)i);
+		}
+	}
+	return res;
+}
+
+void testJsonSimd() {
+	cout << format("{:-^40}\n", "Testing json simd");
+	cout << format("Detected instruction set: {}\n", simd::isaName(simd::detectIsa()));
+	{
+		std::string si = "{\"a\\\"b\":[1,\"x,y\"],\"c\\\\\":{}}";
+		std::vector<uint32_t> expected{ 0, 1, 6, 7, 8, 10, 11, 15, 16, 17, 18, 22, 23, 24, 25, 26 };
+		assert(simd::structuralIndex(si) == expected);
+	}
+	// random inputs over all instruction sets, in one piece and split into chunks
+	std::mt19937 gen(42);
+	const std::string alphabet = "\"\\{}[]:, a1";
+	for (size_t iter = 0; iter < 2000; ++iter) {
+		std::string si(gen() % 300, ' ');
+		for (auto& ch : si) {
+			ch = alphabet[gen() % alphabet.size()];
+		}
+		auto expected = structuralIndexRef(si);
+		for (auto isa : { simd::Isa::Scalar, simd::Isa::Sse42, simd::Isa::Avx2 }) {
+			std::vector<uint32_t> index;
+			simd::IndexState state;
+			simd::buildStructuralIndex(si, index, state, 0, isa);
+			assert(index == expected);
+			// chunks should be multiple of block size, except of the last one
+			index.clear();
+			state = simd::IndexState();
+			for (size_t pos = 0; pos < si.size(); pos += 128) {
+				simd::buildStructuralIndex(std::string_view(si).substr(pos, 128), index, state, pos, isa);
+			}
+			assert(index == expected);
+		}
+	}
+	// positions past 4GiB don't fit index
+	{
+		std::vector<uint32_t> index;
+		simd::IndexState state;
+		bool thrown = false;
+		try {
+			simd::buildStructuralIndex("[1,2]", index, state, simd::MaxIndexedSize - 2);
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown && index.empty());
+	}
+	// decoding with and without index
+	{
+		std::string si = makeJsonDoc(100, 3);
+		JsonEncoder je1;
+		assert(je1.encode(JsonDecoder({ .structuralIndex = true }).decode(si)) == je1.encode(JsonDecoder({ .structuralIndex = false }).decode(si)));
+	}
+}
+
+void testJsonView() {
+	cout << format("{:-^40}\n", "Testing json view");
+	{
+		std::string si = "{\"1\":10,\"2\":\"neko\",\"3\":[15,20,25],\"4\":{\"pim\":3.2,\"bim\":\"8]8}8\",\"vim\":[1,[2,{}],3]}, \"5\" : null}";
+		JsonView jv1(si);
+		assert(jv1.as<int64_t>("1") == 10);
+		assert(jv1.as<std::string>("2") == "neko");
+		assert(jv1.as<int64_t>("3.[1]") == 20);
+		assert(jv1.as<double>("4.pim") == 3.2);
+		assert(jv1.as<std::string>("4.bim") == "8]8}8");
+		assert(jv1.as<int64_t>(std::vector<std::string>{ "4", "vim", "[2]" }) == 3);
+		assert(jv1.as<std::vector<int64_t>>("3") == std::vector<int64_t>({ 15, 20, 25 }));
+		assert(jv1.arrSize("4.vim") == 3);
+		assert(jv1.keys("4") == std::vector<std::string>({ "pim", "bim", "vim" }));
+		assert(jv1.get("5").type() == NodeType::Null);
+		// same member as decoder gives: the last of duplicates, escaped keys are matched
+		{
+			std::string sd = "{\"a\":1,\"k\\u0031\":[2],\"a\":{\"b\":3}}";
+			assert(JsonView(sd).as<int64_t>("a.b") == JsonDecoder().decode(sd).as<int64_t>("a.b"));
+			assert(JsonView(sd).as<int64_t>("k1.[0]") == 2 && JsonView(sd).keys()[1] == "k1");
+		}
+		// views point into text
+		std::string_view name = jv1.as<std::string_view>("2");
+		assert(name == "neko" && name.data() == si.data() + si.find("neko"));
+		assert(JsonView("\"\"").as<std::string_view>().empty());
+		bool thrown = false;
+		try {
+			JsonView("\"ne\\\"ko\"").as<std::string_view>();
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown && JsonView("\"ne\\\"ko\"").as<std::string>() == "ne\"ko");
+		thrown = false;
+		try {
+			jv1.get("4.nope");
+		}
+		catch (const std::out_of_range&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	// reading few fields from big document
+	{
+		std::string si = makeJsonDoc(10000, 2);
+		int64_t res = 0;
+		auto lazyMcs = measureMcs([&]() { res = JsonView(si).as<int64_t>("[5000].child.child.id"); }, 5);
+		assert(res == 5000);
+		auto fullMcs = measureMcs([&]() { res = JsonDecoder().decode(si).as<int64_t>("[5000].child.child.id"); }, 5);
+		assert(res == 5000);
+		cout << format("{} bytes, one field: lazy {}mcs, full decode {}mcs\n", si.size(), lazyMcs, fullMcs);
+	}
+}
+
+void testJsonArena() {
+	cout << format("{:-^40}\n", "Testing json arena");
+	{
+		JsonArena arena(1024);
+		Json copy;
+		{
+			std::string si = makeJsonDoc(100, 1);
+			Json j1 = JsonDecoder().decode(si, arena);
+			assert(j1.as<std::string>("[42].child.name") == "item 42");
+			// copy is independent from arena
+			copy = j1;
+			// modified nodes are allocated outside of arena, so j1 will be destroyed properly
+			j1.get("[1].child") = ValNode(std::string(100, 'x'));
+		}
+		size_t capacity = arena.capacity();
+		arena.reset();
+		// buffer has grown to fit whole document
+		assert(arena.capacity() > capacity);
+		assert(copy.as<std::string>("[42].child.name") == "item 42");
+	}
+	// arena is reset before documents are destroyed
+	{
+		JsonArena arena(1024);
+		std::string si = makeJsonDoc(2000, 1);
+		Json j1 = JsonDecoder().decode(si, arena);
+		Json j2 = JsonDecoder().decode(si, arena);
+		// reading keeps document in arena
+		const Node* root = &std::as_const(j2).get();
+		assert(j2.as<std::string>("[7].child.name") == "item 7" && j2.keys("[7]").size() == 3 && j2.arrSize("[7].tags") == 3);
+		assert(!j2.find("[7].nope") && !j2.find(JsonPath("[7].nope")));
+		assert(&std::as_const(j2).get() == root);
+		// modified document is moved out of arena
+		j2.get("[1].child") = ValNode(std::string(100, 'x'));
+		assert(&std::as_const(j2).get() != root);
+		arena.reset();
+		assert(j2.as<std::string>("[42].child.name") == "item 42" && j2.as<std::string>("[1].child").size() == 100);
+	}
+	// same thread arena for many requests
+	{
+		std::string si = makeJsonDoc(10000, 0);
+		JsonDecoder jd1;
+		auto heapMcs = measureMcs([&]() { Json j1 = jd1.decode(si); }, 5);
+		auto arenaMcs = measureMcs([&]() {
+			{
+				Json j1 = jd1.decode(si, JsonArena::local());
+			}
+			JsonArena::local().reset();
+		}, 5);
+		cout << format("{} bytes, decode and destroy: heap {}mcs, arena {}mcs\n", si.size(), heapMcs, arenaMcs);
+	}
+}
+
+void testJsonBorrowed() {
+	cout << format("{:-^40}\n", "Testing json borrowed strings");
+	{
+		auto source = std::make_shared<std::string>("{\"name\":\"neko\",\"esc\":\"ne\\\"ko\",\"arr\":[\"wanko\"]}");
+		std::string_view si = *source;
+		auto inSource = [si](std::string_view s) { return s.data() >= si.data() && s.data() < si.data() + si.size(); };
+		Json j1 = JsonDecoder().decode(si, source);
+		// document keeps source alive
+		source.reset();
+		assert(j1.as<std::string>("name") == "neko");
+		assert(inSource(j1.as<std::string_view>("name")));
+		assert(inSource(j1.as<std::string_view>("arr.[0]")));
+		assert(!inSource(j1.as<std::string_view>("esc")));
+		for (const auto& [key, node] : std::get<ObjNode>(j1.get()).ccont()) {
+			assert(key.borrowed());
+		}
+		// copies own their strings
+		Json j2 = j1;
+		assert(!inSource(j2.as<std::string_view>("name")));
+		assert(j2.as<std::string>("arr.[0]") == "wanko");
+	}
+	{
+		auto source = std::make_shared<std::string>(makeJsonDoc(100, 1));
+		Json j1 = JsonDecoder().decode(*source, source, JsonArena::local());
+		assert(j1.as<std::string>("[7].child.name") == "item 7");
+	}
+	JsonArena::local().reset();
+}
+
+void testJsonTape() {
+	cout << format("{:-^40}\n", "Testing json tape");
+	{
+		std::string si = "{\"1\":10,\"2\":\"neko\",\"3\":[15,20,25],\"4\":{\"pim\":3.2,\"bim\":\"8]8}8\",\"vim\":[1,[2,{}],3]}, \"5\" : null, \"6\":false}";
+		JsonTape jt1(si);
+		assert(jt1.as<int64_t>("1") == 10);
+		assert(jt1.as<std::string>("2") == "neko");
+		assert(jt1.as<int64_t>("3.[1]") == 20);
+		assert(jt1.as<double>("4.pim") == 3.2);
+		assert(jt1.as<std::string_view>("4.bim") == "8]8}8");
+		assert(jt1.as<int64_t>(std::vector<std::string>{ "4", "vim", "[2]" }) == 3);
+		assert(jt1.as<std::vector<int64_t>>("3") == std::vector<int64_t>({ 15, 20, 25 }));
+		assert(jt1.arrSize("4.vim") == 3);
+		assert(jt1.arrSize("4.vim.[1]") == 2);
+		assert(jt1.keys("4.vim.[1].[1]").empty());
+		assert(jt1.keys("4") == std::vector<std::string>({ "pim", "bim", "vim" }));
+		assert(jt1.get("5").type() == NodeType::Null);
+		assert(jt1.as<bool>("6") == false);
+		bool thrown = false;
+		try {
+			jt1.get("4.nope");
+		}
+		catch (const std::out_of_range&) {
+			thrown = true;
+		}
+		assert(thrown);
+		thrown = false;
+		try {
+			JsonTape("[1,2");
+		}
+		catch (const std::exception&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	// same answers as Json, smaller footprint
+	{
+		std::string si = makeJsonDoc(10000, 2);
+		Json j1 = JsonDecoder().decode(si);
+		JsonTape jt1(si);
+		assert(jt1.arrSize() == j1.arrSize(std::vector<std::string>{}));
+		for (size_t i = 0; i < 10000; i += 997) {
+			std::string path = format("[{}].child.child", i);
+			assert(jt1.as<int64_t>(path + ".id") == j1.as<int64_t>(path + ".id"));
+			assert(jt1.as<std::string>(path + ".name") == j1.as<std::string>(path + ".name"));
+			assert(jt1.as<double>(path + ".ratio") == j1.as<double>(path + ".ratio"));
+			assert(jt1.as<bool>(path + ".active") == j1.as<bool>(path + ".active"));
+		}
+		// everything node tree allocates ends up in arena, so its capacity after reset bounds the tree's footprint
+		JsonArena arena(1024);
+		{
+			Json j2 = JsonDecoder().decode(si, arena);
+		}
+		arena.reset();
+		auto domMcs = measureMcs([&]() { Json j2 = JsonDecoder().decode(si); }, 5);
+		auto tapeMcs = measureMcs([&]() { JsonTape jt2(si); }, 5);
+		cout << format("{} bytes: node tree {} bytes {}mcs, tape {} bytes {}mcs\n", si.size(), arena.capacity(), domMcs, jt1.footprint(), tapeMcs);
+	}
+}
+
+void testJsonStream() {
+	cout << format("{:-^40}\n", "Testing json stream decoding");
+	JsonEncoder je1;
+	// any split of input gives the same document
+	{
+		std::string si = "{\"1\":10,\"2\":\"ne\\\"ko\",\"3\":[15,-20,2.5e3],\"4\":{\"pim\":3.2,\"bim\":true,\"vim\":[1,[2,{}],3]}, \"5\" : null,\"6\":false }";
+		std::string expected = je1.encode(JsonDecoder().decode(si));
+		JsonStreamDecoder jsd1;
+		for (size_t step = 1; step <= si.size(); ++step) {
+			for (size_t pos = 0; pos < si.size(); pos += step) {
+				jsd1.feed(std::string_view(si).substr(pos, step));
+			}
+			assert(jsd1.done());
+			assert(je1.encode(jsd1.finish()) == expected);
+		}
+		// root number ends with input
+		jsd1.feed("12");
+		jsd1.feed("34 ");
+		assert(jsd1.finish().as<int64_t>() == 1234);
+		jsd1.feed("5");
+		assert(!jsd1.done());
+		assert(jsd1.finish().as<int64_t>() == 5);
+		assert(jsd1.finish().empty());
+	}
+	{
+		std::string invalid[] = { "[1,2", "{\"a\":}", "[1 2]", "{\"a\" 1}", "\"abc", "tru", "[nul]", "{} {}", "[1,]" };
+		JsonStreamDecoder jsd1;
+		for (const auto& si : invalid) {
+			bool thrown = false;
+			try {
+				for (char ch : si) {
+					jsd1.feed(std::string_view(&ch, 1));
+				}
+				jsd1.finish();
+			}
+			catch (const std::exception&) {
+				thrown = true;
+			}
+			assert(thrown);
+			jsd1.reset();
+		}
+	}
+	// receiving in socket-sized chunks
+	{
+		std::string si = makeJsonDoc(10000, 2);
+		std::string expected = je1.encode(JsonDecoder().decode(si));
+		std::mt19937 rng(7);
+		JsonStreamDecoder jsd1;
+		for (size_t pos = 0; pos < si.size();) {
+			size_t n = std::uniform_int_distribution<size_t>(1, 10 * 1024)(rng);
+			std::vector<uint8_t> chunk(si.begin() + pos, si.begin() + std::min(si.size(), pos + n));
+			jsd1.feed(std::span<const uint8_t>(chunk));
+			pos += chunk.size();
+		}
+		assert(je1.encode(jsd1.finish()) == expected);
+		auto wholeMcs = measureMcs([&]() { Json j1 = JsonDecoder().decode(si); }, 5);
+		auto streamMcs = measureMcs([&]() {
+			for (size_t pos = 0; pos < si.size(); pos += 4096) {
+				jsd1.feed(std::string_view(si).substr(pos, 4096));
+			}
+			Json j1 = jsd1.finish();
+		}, 5);
+		cout << format("{} bytes: whole input {}mcs, 4KB chunks {}mcs\n", si.size(), wholeMcs, streamMcs);
+	}
+}
+
+// sums all values of given key, without building document
+struct SumHandler : SaxHandlerBase {
+	std::string_view key;
+	std::string_view lastKey;
+	double sum = 0;
+	size_t objects = 0;
+	inline void onStartObject() { ++objects; }
+	inline void onKey(std::string_view k) { lastKey = k; }
+	inline void onInt(int64_t val) { onDouble((double)val); }
+	inline void onDouble(double val) {
+		if (lastKey == key) {
+			sum += val;
+		}
+	}
+};
+
+// writes events back as json text
+struct EchoHandler {
+	std::string out;
+	std::vector<bool> first{ true };
+	inline void sep() {
+		if (!first.back() && out.back() != ':') {
+			out.push_back(',');
+		}
+		first.back() = false;
+	}
+	inline void onStartObject() { sep(); out.push_back('{'); first.push_back(true); }
+	inline void onKey(std::string_view k) { sep(); out.append(format("\"{}\":", k)); }
+	inline void onEndObject() { out.push_back('}'); first.pop_back(); }
+	inline void onStartArray() { sep(); out.push_back('['); first.push_back(true); }
+	inline void onEndArray() { out.push_back(']'); first.pop_back(); }
+	inline void onString(std::string_view s) { sep(); out.append(format("\"{}\"", s)); }
+	inline void onInt(int64_t val) { sep(); out.append(std::to_string(val)); }
+	inline void onDouble(double val) { sep(); out.append(format("{}", val)); }
+	inline void onBool(bool val) { sep(); out.append(val ? "true" : "false"); }
+	inline void onNull() { sep(); out.append("null"); }
+};
+
+void testJsonSax() {
+	cout << format("{:-^40}\n", "Testing json sax");
+	{
+		std::string si = "{ \"1\" : 10,\"2\":\"ne\\\"ko\",\"3\":[15,-20,2.5],\"4\":{\"pim\":true,\"vim\":[[],{}],\"bim\":null}}";
+		EchoHandler h;
+		parseSax(si, h);
+		assert(h.out == "{\"1\":10,\"2\":\"ne\\\"ko\",\"3\":[15,-20,2.5],\"4\":{\"pim\":true,\"vim\":[[],{}],\"bim\":null}}");
+		bool thrown = false;
+		try {
+			parseSax("[1,2", h);
+		}
+		catch (const std::exception&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	// aggregating without document
+	{
+		std::string si = makeJsonDoc(10000, 2);
+		SumHandler h;
+		h.key = "ratio";
+		SaxParser<SumHandler> parser(h);
+		parser.parse(si);
+		Json j1 = JsonDecoder().decode(si);
+		double expected = 0;
+		for (size_t i = 0; i < 10000; ++i) {
+			expected += j1.as<double>(format("[{}].child.child.ratio", i));
+		}
+		assert(h.sum == expected);
+		assert(h.objects == 30000);
+		auto saxMcs = measureMcs([&]() { parser.parse(si); }, 5);
+		auto domMcs = measureMcs([&]() { Json j2 = JsonDecoder().decode(si); }, 5);
+		cout << format("{} bytes, sum of field: sax {}mcs, document {}mcs\n", si.size(), saxMcs, domMcs);
+	}
+}
+
+void testJsonNdjson() {
+	cout << format("{:-^40}\n", "Testing ndjson");
+	auto makeRecords = [](size_t n) {
+		std::string res;
+		for (size_t i = 0; i < n; ++i) {
+			res.append(format("{{\"id\":{0},\"msg\":\"record {0}\",\"tags\":[1,2,3],\"level\":{{\"n\":{1}}}}}\n", i, i % 7));
+			// empty lines are skipped
+			if (i % 100 == 0) {
+				res.append("\r\n");
+			}
+		}
+		return res;
+	};
+	{
+		std::string si = makeRecords(20000);
+		for (size_t threads : { 1, 4 }) {
+			size_t expected = 0;
+			size_t n = NdjsonDecoder({ .threads = threads, .batchSize = 4096 }).decode(si, [&](Json&& record) {
+				assert(record.as<int64_t>("id") == (int64_t)expected);
+				assert(record.as<std::string>("msg") == format("record {}", expected));
+				++expected;
+			});
+			assert(n == 20000 && expected == 20000);
+		}
+	}
+	// records before invalid one are delivered
+	{
+		std::string si = makeRecords(1000) + "{\"id\":1000,}\n" + makeRecords(10);
+		size_t delivered = 0;
+		bool thrown = false;
+		try {
+			NdjsonDecoder({ .threads = 4, .batchSize = 1024 }).decode(si, [&](Json&&) { ++delivered; });
+		}
+		catch (const std::runtime_error& e) {
+			thrown = std::string_view(e.what()).find("line 1011") != std::string_view::npos;
+		}
+		assert(thrown && delivered == 1000);
+	}
+	// single thread decodes batch right before its delivery and stops at error
+	{
+		std::string si;
+		for (size_t i = 0; i < 100; ++i) {
+			si.append(i == 50 ? "{,}\n" : format("{{\"k{}\":1}}\n", i));
+		}
+		NdjsonDecoder::Opts opts{ .threads = 1, .batchSize = 1 };
+		opts.decoder.keys = std::make_shared<JsonKeyPool>();
+		size_t delivered = 0;
+		bool thrown = false;
+		try {
+			NdjsonDecoder(opts).decode(si, [&](Json&&) {
+				// keys of following records aren't interned yet
+				assert(opts.decoder.keys->stats().keys == ++delivered);
+			});
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown && delivered == 50 && opts.decoder.keys->stats().keys == 50);
+	}
+	{
+		std::string path = "f:/records.ndjson";
+		std::string si = makeRecords(100000);
+		std::ofstream(path, std::ios::binary) << si;
+		size_t n = NdjsonDecoder({ .borrowStrings = true }).decodeFile(path, [](Json&& record) {
+			assert(record.as<std::string_view>("msg").starts_with("record"));
+		});
+		assert(n == 100000);
+		for (size_t threads : { 1, 2, 4, 8 }) {
+			auto mcs = measureMcs([&]() { NdjsonDecoder({ .threads = threads }).decodeFile(path, [](Json&&) {}); }, 3);
+			cout << format("{} bytes, {} threads: {}mcs\n", si.size(), threads, mcs);
+		}
+		std::remove(path.c_str());
+	}
+}
+
+void testJsonFile() {
+	cout << format("{:-^40}\n", "Testing json file decoding");
+	std::string path = "f:/doc.json";
+	std::string si = makeJsonDoc(20000, 2);
+	std::ofstream(path, std::ios::binary) << si;
+	JsonEncoder je1;
+	std::string expected = je1.encode(JsonDecoder().decode(si));
+	assert(je1.encode(JsonDecoder().decodeFile(path)) == expected);
+	assert(je1.encode(JsonDecoder().decode(std::ifstream(path))) == expected);
+	{
+		Json j1 = JsonDecoder().decodeFile(path, true);
+		for (const auto& [key, node] : std::get<ObjNode>(j1.get("[7]")).ccont()) {
+			assert(key.borrowed());
+		}
+		assert(j1.as<std::string>("[7].child.child.name") == "item 7");
+	}
+	auto streamMcs = measureMcs([&]() { Json j1 = JsonDecoder().decode(std::ifstream(path)); }, 3);
+	auto mappedMcs = measureMcs([&]() { Json j1 = JsonDecoder().decodeFile(path); }, 3);
+	auto borrowedMcs = measureMcs([&]() { Json j1 = JsonDecoder().decodeFile(path, true); }, 3);
+	cout << format("{} bytes: ifstream {}mcs, mapped {}mcs, mapped with borrowed strings {}mcs\n", si.size(), streamMcs, mappedMcs, borrowedMcs);
+	std::remove(path.c_str());
+}
+
+// coordinates of polygons, like in geojson maps
+static std::string makeGeoJson(size_t features, size_t points) {
+	std::mt19937 rng(3);
+	std::uniform_real_distribution<double> lon(-180, 180), lat(-90, 90);
+	std::string res = "{\"type\":\"FeatureCollection\",\"features\":[";
+	for (size_t i = 0; i < features; ++i) {
+		res.append(i ? "," : "").append(format("{{\"type\":\"Feature\",\"properties\":{{\"id\":{}}},\"geometry\":{{\"type\":\"Polygon\",\"coordinates\":[[", i));
+		for (size_t j = 0; j < points; ++j) {
+			res.append(format("{}[{:.6f},{:.6f}]", j ? "," : "", lon(rng), lat(rng)));
+		}
+		res.append("]]}}");
+	}
+	res.append("]}");
+	return res;
+}
+
+void testJsonDecodeNumbers() {
+	cout << format("{:-^40}\n", "Testing json number decoding");
+	auto parse = [](std::string_view v) {
+		size_t pos = 0;
+		auto res = utils::parseNumber(v, pos);
+		assert(pos == v.size());
+		return res;
+	};
+	auto asDouble = [&parse](std::string_view v) { return std::get<double>(parse(v)); };
+	assert(std::get<int64_t>(parse("0")) == 0);
+	assert(std::get<int64_t>(parse("-0")) == 0);
+	assert(std::get<int64_t>(parse("9223372036854775807")) == std::numeric_limits<int64_t>::max());
+	assert(std::get<int64_t>(parse("-9223372036854775808")) == std::numeric_limits<int64_t>::min());
+	// out of int64_t range
+	assert(asDouble("9223372036854775808") == 9223372036854775808.0);
+	assert(asDouble("-9223372036854775809") == -9223372036854775809.0);
+	assert(asDouble("123456789012345678901234567890") == 123456789012345678901234567890.0);
+	assert(asDouble("1e5") == 100000.0);
+	assert(asDouble("1E+2") == 100.0);
+	assert(asDouble("2.5e-3") == 0.0025);
+	assert(asDouble("-0.0") == 0.0 && std::signbit(asDouble("-0.0")));
+	assert(asDouble("0.000000000000000000000000001") == 1e-27);
+	assert(asDouble("1.7976931348623157e308") == std::numeric_limits<double>::max());
+	assert(asDouble("4.9e-324") == std::numeric_limits<double>::denorm_min());
+	// underflow - zero with sign
+	assert(asDouble("1.5e-400") == 0.0 && !std::signbit(asDouble("1.5e-400")));
+	assert(asDouble("-1e-400") == 0.0 && std::signbit(asDouble("-1e-400")));
+	assert(asDouble("1e-99999999999") == 0.0);
+	assert(JsonDecoder().decode("[1.5e-400]").as<double>("[0]") == 0.0);
+	{
+		size_t pos = 0;
+		// stops at first character which isn't a part of number
+		assert(std::get<int64_t>(utils::parseNumber("12,3", pos)) == 12 && pos == 2);
+	}
+	for (std::string si : { "-", "01", "-01", "1.", ".5", "1.e5", "1e", "1e+", "+1", "--1", "1e400", "-1e400", "123456789012345678901234567890e300" }) {
+		bool thrown = false;
+		try {
+			size_t pos = 0;
+			utils::parseNumber(si, pos);
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	assert(JsonDecoder().decode("[1e2]").as<double>("[0]") == 100.0);
+	assert(check::getType("1e2") == NodeType::Float);
+	// same doubles as std::from_chars in any notation
+	std::mt19937_64 rng(4);
+	for (size_t i = 0; i < 20000; ++i) {
+		double val = std::bit_cast<double>(rng());
+		if (!std::isfinite(val)) {
+			continue;
+		}
+		double small = static_cast<double>(static_cast<int64_t>(rng() % 2000000000) - 1000000000) / 1000.0;
+		for (std::string si : { format("{}", val), format("{:e}", val), format("{:.17g}", val), format("{:.6f}", small), format("{}", small) }) {
+			double expected;
+			std::from_chars(si.data(), si.data() + si.size(), expected);
+			auto res = parse(si);
+			double got = std::holds_alternative<double>(res) ? std::get<double>(res) : static_cast<double>(std::get<int64_t>(res));
+			assert(std::bit_cast<uint64_t>(got) == std::bit_cast<uint64_t>(expected));
+		}
+		int64_t ival = static_cast<int64_t>(rng());
+		assert(std::get<int64_t>(parse(format("{}", ival))) == ival);
+	}
+	{
+		std::string si = makeGeoJson(2000, 50);
+		std::vector<std::string_view> numbers;
+		for (size_t pos = 0; pos < si.size();) {
+			if (check::isNumberStart(si[pos]) && !isdigit(si[pos - 1])) {
+				size_t end = si.find_first_of(",]}", pos);
+				numbers.push_back(std::string_view(si).substr(pos, end - pos));
+				pos = end;
+			}
+			else {
+				++pos;
+			}
+		}
+		double sum = 0;
+		auto mcs = measureMcs([&]() {
+			for (auto number : numbers) {
+				size_t pos = 0;
+				auto res = utils::parseNumber(number, pos);
+				sum += std::holds_alternative<double>(res) ? std::get<double>(res) : 1;
+			}
+		}, 5);
+		auto fromCharsMcs = measureMcs([&]() {
+			for (auto number : numbers) {
+				double val;
+				std::from_chars(number.data(), number.data() + number.size(), val);
+				sum += val;
+			}
+		}, 5);
+		cout << format("{} numbers: parseNumber {}mcs, from_chars {}mcs\n", numbers.size(), mcs, fromCharsMcs);
+		Json j1;
+		mcs = measureMcs([&]() { j1 = JsonDecoder().decode(si); }, 5);
+		assert(j1.arrSize("features.[1999].geometry.coordinates.[0]") == 50);
+		cout << format("geojson {} bytes: {}mcs\n", si.size(), mcs);
+	}
+}
+
+void testJsonEncodeNumbers() {
+	cout << format("{:-^40}\n", "Testing json number encoding");
+	JsonEncoder je1;
+	assert(je1.encode(Json(ValNode(3.2))) == "3.2");
+	assert(je1.encode(Json(ValNode(-0.1))) == "-0.1");
+	// stays float after decoding
+	assert(je1.encode(Json(ValNode(2.0))) == "2.0");
+	assert(je1.encode(Json(ValNode(1e300))) == "1e+300");
+	assert(je1.encode(Json(ValNode(std::numeric_limits<double>::infinity()))) == "null");
+	assert(je1.encode(Json(ValNode(std::numeric_limits<int64_t>::min()))) == "-9223372036854775808");
+	// shortest representation is decoded back exactly
+	std::mt19937_64 rng(1);
+	for (size_t i = 0; i < 10000; ++i) {
+		double val = std::bit_cast<double>(rng());
+		if (!std::isfinite(val)) {
+			continue;
+		}
+		Json j1 = JsonDecoder().decode(je1.encode(Json(ValNode(val))));
+		assert(j1.as<double>() == val);
+	}
+	// appending to reused buffer
+	std::string out = "x";
+	je1.encode(Json(ArrNode({ 1, 2.5, "s" })), out);
+	assert(out == "x[1,2.5,\"s\"]");
+	{
+		Json j1 = JsonDecoder().decode(makeJsonDoc(10000, 2));
+		std::string buf;
+		auto mcs = measureMcs([&]() {
+			buf.clear();
+			je1.encode(j1, buf);
+		}, 5);
+		auto hrMcs = measureMcs([&]() { JsonEncoder({ .humanReadable = true }).encode(j1); }, 5);
+		cout << format("{} bytes: {}mcs, human readable {}mcs\n", buf.size(), mcs, hrMcs);
+	}
+}
+
+void testJsonEncodeEscape() {
+	cout << format("{:-^40}\n", "Testing json string escaping");
+	JsonEncoder je1;
+	assert(je1.encode(Json(ValNode("a\"b\\c/\n\t\x01\x7f"))) == "\"a\\\"b\\\\c/\\n\\t\\u0001\x7f\"");
+	assert(je1.encode(Json(ObjNode({ { "k\"", ValNode(1) } }))) == "{\"k\\\"\":1}");
+	assert(je1.encode(Json(ValNode("\xd0\xbd\xd0\xb5\xd0\xba\xd0\xbe \xe2\x82\xac \xf0\x9f\x98\x80"))) == "\"\xd0\xbd\xd0\xb5\xd0\xba\xd0\xbe \xe2\x82\xac \xf0\x9f\x98\x80\"");
+	// every instruction set gives the same result, special characters at all positions of vector
+	const std::string parts[] = { "a", "b", "\"", "\\", "\n", "\x1f", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80" };
+	std::mt19937 rng(1);
+	for (size_t i = 0; i < 2000; ++i) {
+		std::string si;
+		size_t len = rng() % 100;
+		for (size_t j = 0; j < len; ++j) {
+			// mostly clean text
+			si.append(rng() % 4 ? "x" : parts[rng() % std::size(parts)]);
+		}
+		std::string expected;
+		simd::escapeStr(si, expected, simd::Isa::Scalar);
+		for (auto isa : { simd::Isa::Sse42, simd::Isa::Avx2 }) {
+			std::string res;
+			simd::escapeStr(si, res, isa);
+			assert(res == expected);
+		}
+	}
+	// invalid utf-8: stray continuation, overlong, surrogate, truncated, above U+10FFFF
+	for (std::string bad : { "\x80", "\xc0\xaf", "\xed\xa0\x80", "\xe2\x82", "\xf4\x90\x80\x80", "\xff" }) {
+		for (auto isa : { simd::Isa::Scalar, simd::Isa::Sse42, simd::Isa::Avx2 }) {
+			for (std::string si : { bad, std::string(40, 'x') + bad + std::string(40, 'x') }) {
+				bool thrown = false;
+				try {
+					std::string res;
+					simd::escapeStr(si, res, isa);
+				}
+				catch (const std::runtime_error&) {
+					thrown = true;
+				}
+				assert(thrown);
+			}
+		}
+	}
+	{
+		std::string text;
+		while (text.size() < 1000) {
+			text.append("Cupidatat eu irure officia cillum, esse labore voluptate. ");
+		}
+		ArrNode arr;
+		for (size_t i = 0; i < 1000; ++i) {
+			arr.cont().push_back(ValNode(text));
+		}
+		Json j1(std::move(arr));
+		std::string buf;
+		for (auto isa : { simd::Isa::Scalar, simd::Isa::Sse42, simd::Isa::Avx2 }) {
+			auto mcs = measureMcs([&]() {
+				buf.clear();
+				for (const auto& node : std::get<ArrNode>(j1.get()).ccont()) {
+					simd::escapeStr(std::get<ValNode>(node).as<std::string_view>(), buf, isa);
+				}
+			}, 5);
+			cout << format("{} bytes of strings, {}: {}mcs\n", buf.size(), simd::isaName(std::min(isa, simd::detectIsa())), mcs);
+		}
+		auto mcs = measureMcs([&]() {
+			buf.clear();
+			for (const auto& node : std::get<ArrNode>(j1.get()).ccont()) {
+				buf.append(std::get<ValNode>(node).as<std::string_view>());
+			}
+		}, 5);
+		cout << format("{} bytes of strings, copying: {}mcs\n", buf.size(), mcs);
+	}
+}
+
+void testJsonUnescape() {
+	cout << format("{:-^40}\n", "Testing json string unescaping");
+	auto unescape = [](std::string_view v, simd::Isa isa) {
+		std::string res(v.size(), '\0');
+		res.resize(simd::unescapeStr(v, res.data(), isa));
+		return res;
+	};
+	const simd::Isa isas[] = { simd::Isa::Scalar, simd::Isa::Sse42, simd::Isa::Avx2 };
+	{
+		JsonDecoder jd1;
+		Json j1 = jd1.decode("[\"a\\nb\\t\\\"c\\\\\\/\",\"\\u00e9\\u20AC\\ud83d\\ude00\",\"\xd0\xbd\xd0\xb5\xd0\xba\xd0\xbe\",{\"k\\u0031\":1}]");
+		assert(j1.as<std::string>("[0]") == "a\nb\t\"c\\/");
+		assert(j1.as<std::string>("[1]") == "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+		assert(j1.as<std::string>("[2]") == "\xd0\xbd\xd0\xb5\xd0\xba\xd0\xbe");
+		assert(j1.as<int64_t>("[3].k1") == 1);
+		// and back
+		assert(JsonEncoder().encode(j1) == "[\"a\\nb\\t\\\"c\\\\/\",\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\",\"\xd0\xbd\xd0\xb5\xd0\xba\xd0\xbe\",{\"k1\":1}]");
+		assert(JsonTape(std::string_view("{\"k\\\"\":\"\\u0041\\n\"}")).as<std::string>("k\"") == "A\n");
+		// raw control characters aren't allowed in json strings (but are in strings of binary formats)
+		for (std::string si : std::vector<std::string>{ std::string("[\"a\x01" "b\"]"), "[\"a\\nb\nc\"]", "{\"a\tb\":1}", "[\"" + std::string(40, 'x') + "\x1f\"]" }) {
+			bool thrown = false;
+			try {
+				jd1.decode(si);
+			}
+			catch (const std::runtime_error&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+		assert(CborDecoder().decode(CborEncoder().encode(Json(ValNode(std::string("a\x01" "b"))))).as<std::string>() == "a\x01" "b");
+	}
+	// fuzzing: random mix of pieces with known decoding, all instruction sets should agree with it
+	const std::pair<std::string, std::string> valid[] = {
+		{ "\\n", "\n" }, { "\\\"", "\"" }, { "\\\\", "\\" }, { "\\/", "/" }, { "\\b\\f\\r\\t", "\b\f\r\t" },
+		{ "\\u0041", "A" }, { "\\u00e9", "\xc3\xa9" }, { "\\u20AC", "\xe2\x82\xac" }, { "\\ud83d\\ude00", "\xf0\x9f\x98\x80" },
+		{ "\xc3\xa9", "\xc3\xa9" }, { "\xf0\x9f\x98\x80", "\xf0\x9f\x98\x80" }, { "\x7f", "\x7f" }
+	};
+	// lone backslash is tested at the end only - it would escape next piece
+	const std::string invalid[] = { "\\q", "\\u12g4", "\\ud800", "\\ud800\\u0041", "\\udc00", "\xc0\xaf", "\xed\xa0\x80", "\x80", "\x01", "\n", "\x1f", std::string(1, '\0') };
+	std::mt19937 rng(2);
+	for (size_t i = 0; i < 20000; ++i) {
+		std::string raw, expected;
+		std::vector<size_t> boundaries = { 0 };
+		size_t len = rng() % 80;
+		for (size_t j = 0; j < len; ++j, boundaries.push_back(raw.size())) {
+			if (rng() % 3) {
+				raw.push_back('x');
+				expected.push_back('x');
+			}
+			else {
+				const auto& [r, e] = valid[rng() % std::size(valid)];
+				raw.append(r);
+				expected.append(e);
+			}
+		}
+		bool bad = rng() % 8 == 0;
+		if (bad) {
+			if (rng() % 8) {
+				raw.insert(boundaries[rng() % boundaries.size()], invalid[rng() % std::size(invalid)]);
+			}
+			else {
+				raw.push_back('\\');
+			}
+		}
+		for (auto isa : isas) {
+			bool thrown = false;
+			try {
+				assert(unescape(raw, isa) == expected);
+				assert((simd::findEscape(raw, isa) == raw.npos) == (raw.find('\\') == raw.npos));
+			}
+			catch (const std::runtime_error&) {
+				thrown = true;
+			}
+			assert(thrown == bad);
+		}
+	}
+	// whatever is encoded is decoded back
+	for (size_t i = 0; i < 2000; ++i) {
+		std::string si;
+		size_t len = rng() % 60;
+		for (size_t j = 0; j < len; ++j) {
+			si.append(rng() % 2 ? std::string(1, static_cast<char>(rng() % 0x80)) : valid[rng() % std::size(valid)].second);
+		}
+		assert(JsonDecoder().decode(JsonEncoder().encode(Json(ValNode(si)))).as<std::string>() == si);
+	}
+	{
+		std::string si = "[";
+		for (size_t i = 0; i < 10000; ++i) {
+			si.append(i ? "," : "").append("\"Cupidatat eu irure officia cillum, esse labore voluptate.\\r\\n \\u00e9\"");
+		}
+		si.append("]");
+		std::string_view raw = std::string_view(si).substr(2, si.find('"', 2) - 2);
+		std::string buf(raw.size(), '\0');
+		for (auto isa : isas) {
+			auto mcs = measureMcs([&]() {
+				for (size_t i = 0; i < 10000; ++i) {
+					simd::unescapeStr(raw, buf.data(), isa);
+				}
+			}, 5);
+			cout << format("{} bytes of strings, {}: {}mcs\n", raw.size() * 10000, simd::isaName(std::min(isa, simd::detectIsa())), mcs);
+		}
+		Json j1;
+		auto mcs = measureMcs([&]() { j1 = JsonDecoder().decode(si); }, 5);
+		assert(j1.as<std::string>("[9999]").ends_with("\r\n \xc3\xa9"));
+		cout << format("{} bytes document: {}mcs\n", si.size(), mcs);
+	}
+}
+
+// keeps track of chunk sizes
+struct CountingJsonWriter : JsonWriter {
+	std::string out;
+	size_t chunks = 0;
+	size_t maxChunk = 0;
+	void write(std::string& chunk) override {
+		out.append(chunk);
+		++chunks;
+		maxChunk = std::max(maxChunk, chunk.size());
+	}
+};
+
+// takes up to 'budget' bytes, then returns EAGAIN
+struct BudgetSocket : inet::ISocket {
+	std::string out;
+	size_t budget = SIZE_MAX;
+	// longest chain seen while writing
+	std::deque<inet::OutputSocketBuffer>* chain = nullptr;
+	size_t maxChain = 0;
+	int init() const override { return 0; }
+	std::pair<ssize_t, std::shared_ptr<ISocket>> accept() const override { return { -1, nullptr }; }
+	ssize_t read(inet::InputSocketBuffer&) const override { return -EAGAIN; }
+	ssize_t write(inet::OutputSocketBuffer& buf) const override {
+		auto self = const_cast<BudgetSocket*>(this);
+		self->maxChain = std::max(maxChain, chain->size());
+		size_t n = std::min(budget, buf.size() - buf.offset());
+		if (!n) {
+			return -EAGAIN;
+		}
+		self->budget -= n;
+		return buf.write([self, n](int, const char* data, size_t) { self->out.append(data, n); return (ssize_t)n; }, 0);
+	}
+	int close() override { return 0; }
+	int fd() const override { return 0; }
+	std::string strerr() const override { return ""; }
+};
+
+void testJsonWriter() {
+	cout << format("{:-^40}\n", "Testing json writers");
+	Json j1 = JsonDecoder().decode(makeJsonDoc(10000, 2));
+	for (bool hr : { false, true }) {
+		JsonEncoder je1({ .humanReadable = hr, .chunkSize = 4096 });
+		std::string expected = je1.encode(j1);
+		CountingJsonWriter w1;
+		je1.encode(j1, w1);
+		assert(w1.out == expected);
+		assert(w1.chunks >= expected.size() / (4096 + 256));
+		// elements of document are small
+		assert(w1.maxChunk < 4096 + 256);
+	}
+	JsonEncoder je1({ .chunkSize = 4096 });
+	std::string expected = je1.encode(j1);
+	{
+		std::deque<inet::OutputSocketBuffer> chain;
+		SocketBufferJsonWriter w1(chain);
+		je1.encode(j1, w1);
+		std::string res;
+		for (auto& segment : chain) {
+			segment.write([&res](int, const char* data, size_t n) { res.append(data, n); return (ssize_t)n; }, 0);
+			assert(segment.finished());
+		}
+		assert(res == expected);
+	}
+	// chunks are sent while encoding
+	{
+		std::deque<inet::OutputSocketBuffer> chain;
+		BudgetSocket socket;
+		socket.chain = &chain;
+		SocketBufferJsonWriter w1(chain, socket);
+		je1.encode(j1, w1);
+		assert(socket.out == expected && chain.empty() && socket.maxChain == 1);
+	}
+	// what socket couldn't take is left in chain
+	{
+		std::deque<inet::OutputSocketBuffer> chain;
+		BudgetSocket socket;
+		socket.chain = &chain;
+		socket.budget = 10000;
+		SocketBufferJsonWriter w1(chain, socket);
+		je1.encode(j1, w1);
+		assert(socket.out == expected.substr(0, 10000) && !chain.empty());
+		std::string res = socket.out;
+		for (auto& segment : chain) {
+			segment.write([&res](int, const char* data, size_t n) { res.append(data, n); return (ssize_t)n; }, 0);
+		}
+		assert(res == expected);
+	}
+	{
+		std::string path = "f:/enc.json";
+		FILE* f = fopen(path.c_str(), "wb");
+		FdJsonWriter w1(fileno(f));
+		je1.encode(j1, w1);
+		fclose(f);
+		je1.dump(j1, std::ofstream(path, std::ios::app));
+		std::stringstream ss;
+		ss << std::ifstream(path).rdbuf();
+		assert(ss.str() == expected + expected + "\n");
+		std::remove(path.c_str());
+	}
+	{
+		CountingJsonWriter w1;
+		auto mcs = measureMcs([&]() {
+			w1.out.clear();
+			je1.encode(j1, w1);
+		}, 5);
+		cout << format("{} bytes in {}KB chunks: {}mcs\n", w1.out.size(), 4, mcs);
+	}
+}
+
+struct TestFriend {
+	int64_t id = 0;
+	std::string name;
+	bool operator==(const TestFriend&) const = default;
+	static constexpr auto jsonFields() {
+		return std::make_tuple(JSON_FIELD(TestFriend, id), JSON_FIELD(TestFriend, name));
+	}
+	ObjNode toObjNode() const {
+		return ObjNode({ { "id", ValNode(id) }, { "name", ValNode(name) } });
+	}
+};
+
+struct TestPerson {
+	std::string guid;
+	int64_t index = 0;
+	bool isActive = false;
+	int age = 0;
+	double latitude = 0;
+	std::string name;
+	std::vector<std::string> tags;
+	std::vector<TestFriend> friends;
+	std::optional<std::string> nickname;
+	bool operator==(const TestPerson&) const = default;
+	static constexpr auto jsonFields() {
+		return std::make_tuple(JSON_FIELD(TestPerson, guid), JSON_FIELD(TestPerson, index), JSON_FIELD(TestPerson, isActive),
+			JSON_FIELD(TestPerson, age), JSON_FIELD(TestPerson, latitude), JSON_FIELD(TestPerson, name), JSON_FIELD(TestPerson, tags),
+			JSON_FIELD(TestPerson, friends), field("nick", &TestPerson::nickname));
+	}
+	ObjNode toObjNode() const {
+		std::vector<Node> tagNodes(tags.begin(), tags.end());
+		return ObjNode({ { "guid", ValNode(guid) }, { "index", ValNode(index) }, { "isActive", ValNode(isActive) },
+			{ "age", ValNode((int64_t)age) }, { "latitude", ValNode(latitude) }, { "name", ValNode(name) },
+			{ "tags", ArrNode(std::move(tagNodes)) }, { "friends", ArrNode::makeFrom(friends) },
+			{ "nick", nickname ? ValNode(*nickname) : ValNode() } });
+	}
+};
+
+struct TestInts {
+	uint8_t small = 0;
+	int32_t mid = 0;
+	uint64_t big = 0;
+	static constexpr auto jsonFields() {
+		return std::make_tuple(JSON_FIELD(TestInts, small), JSON_FIELD(TestInts, mid), JSON_FIELD(TestInts, big));
+	}
+};
+
+// type which can't be changed
+struct TestPoint {
+	double x = 0;
+	double y = 0;
+};
+
+template<>
+struct util::web::json::JsonFields<TestPoint> {
+	static constexpr auto get() {
+		return std::make_tuple(JSON_FIELD(TestPoint, x), JSON_FIELD(TestPoint, y));
+	}
+};
+
+void testJsonReflect() {
+	cout << format("{:-^40}\n", "Testing json struct reflection");
+	TestPerson p1{ "e713b670", 3, true, 39, -69.053469, "Robbie \"Heath\"", { "ipsum", "irure" }, { { 0, "Sheryl" }, { 1, "Ochoa" } }, std::nullopt };
+	std::string se = encodeStruct(p1);
+	assert(se == "{\"guid\":\"e713b670\",\"index\":3,\"isActive\":true,\"age\":39,\"latitude\":-69.053469,\"name\":\"Robbie \\\"Heath\\\"\","
+		"\"tags\":[\"ipsum\",\"irure\"],\"friends\":[{\"id\":0,\"name\":\"Sheryl\"},{\"id\":1,\"name\":\"Ochoa\"}],\"nick\":null}");
+	assert(decodeStruct<TestPerson>(se) == p1);
+	// same document as dom encoder gives
+	assert(JsonDecoder().decode(se).as<std::string>("friends.[1].name") == "Ochoa");
+	assert(decodeStruct<TestPerson>(JsonEncoder().encode(Json(p1.toObjNode()))) == p1);
+	p1.nickname = "rob";
+	assert(decodeStruct<TestPerson>(encodeStruct(p1)) == p1);
+	// unknown keys are skipped, missing ones keep values, escaped keys are matched
+	{
+		TestPerson p2 = decodeStruct<TestPerson>(" { \"extra\" : {\"a\":[1,{\"b\":\"}\"}]}, \"na\\u006de\" : \"x\", \"age\":5, \"more\":\"s\" , \"tags\":[] }");
+		assert(p2.name == "x" && p2.age == 5 && p2.tags.empty() && p2.friends.empty() && !p2.nickname);
+		TestFriend f1{ 7, "keep" };
+		decodeStruct("{\"id\":8}", f1);
+		assert(f1.id == 8 && f1.name == "keep");
+	}
+	{
+		auto points = decodeStruct<std::vector<TestPoint>>("[{\"x\":1,\"y\":2.5},{\"y\":-1e2}]");
+		assert(points.size() == 2 && points[0].x == 1.0 && points[0].y == 2.5 && points[1].x == 0 && points[1].y == -100.0);
+		assert(encodeStruct(points) == "[{\"x\":1.0,\"y\":2.5},{\"x\":0.0,\"y\":-100.0}]");
+	}
+	for (std::string si : { "{\"age\":\"5\"}", "{\"age\":5.5}", "{\"tags\":{}}", "{\"name\":1}", "{\"age\":5", "{\"age\":5,}", "{\"isActive\":tru}", "{} 1" }) {
+		bool thrown = false;
+		try {
+			decodeStruct<TestPerson>(si);
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	// integers out of range of field throw instead of wrapping
+	{
+		TestInts i1{ 255, -2147483648, UINT64_MAX };
+		assert(encodeStruct(i1) == "{\"small\":255,\"mid\":-2147483648,\"big\":18446744073709551615}");
+		TestInts i2 = decodeStruct<TestInts>(encodeStruct(i1));
+		assert(i2.small == 255 && i2.mid == -2147483648 && i2.big == UINT64_MAX);
+		for (std::string si : { "{\"small\":300}", "{\"small\":-1}", "{\"mid\":5000000000}", "{\"mid\":-2147483649}", "{\"big\":-1}",
+			"{\"big\":18446744073709551616}", "{\"big\":1e19}" }) {
+			bool thrown = false;
+			try {
+				decodeStruct<TestInts>(si);
+			}
+			catch (const std::runtime_error&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+	}
+	{
+		std::vector<TestPerson> people;
+		for (size_t i = 0; i < 10000; ++i) {
+			TestPerson p = p1;
+			p.index = i;
+			p.name = format("person {}", i);
+			people.push_back(p);
+		}
+		std::string buf;
+		auto encodeMcs = measureMcs([&]() {
+			buf.clear();
+			encodeStruct(people, buf);
+		}, 5);
+		auto domEncodeMcs = measureMcs([&]() { JsonEncoder().encode(Json(ArrNode::makeFrom(people))); }, 5);
+		std::vector<TestPerson> decoded;
+		auto decodeMcs = measureMcs([&]() { decodeStruct(buf, decoded); }, 5);
+		assert(decoded == people);
+		// without reading values from nodes
+		auto domDecodeMcs = measureMcs([&]() { JsonDecoder().decode(buf); }, 5);
+		cout << format("{} bytes: encode {}mcs (dom {}mcs), decode {}mcs (dom {}mcs)\n", buf.size(), encodeMcs, domEncodeMcs, decodeMcs, domDecodeMcs);
+	}
+}
+
+void testJsonPath() {
+	cout << format("{:-^40}\n", "Testing compiled json paths");
+	Json json = JsonDecoder().decode(makeGeoJson(100, 8));
+	JsonPath path("features.[42].geometry.coordinates.[0].[3].[1]");
+	assert(path.segments().size() == 7 && path.segments()[1].idx == 42 && !path.segments()[0].idx);
+	assert(json.as<double>(path) == json.as<double>(std::string(path.text())));
+	{
+		// segments stay valid in copies
+		JsonPath copy;
+		{
+			JsonPath tmp = path;
+			copy = std::move(tmp);
+		}
+		assert(copy.text() == path.text() && json.as<double>(copy) == json.as<double>(path));
+	}
+	// computed at compile time
+	constexpr auto& typePath = jsonPath<"features.[7].geometry.type">;
+	static_assert(typePath.size() == 4 && typePath[1].idx == 7 && typePath[3].hash == utils::hashKey("type"));
+	assert(json.as<std::string>(typePath) == "Polygon");
+	assert(&json.get(JsonPath()) == &json.get());
+	for (auto bad : { "features.[100]", "features.[x]", "features.[1].nokey", "features.[1].type.[0]", "features.[1].properties.id.x", "features.type" }) {
+		bool thrown = false;
+		try {
+			json.get(JsonPath(bad));
+		}
+		catch (const std::out_of_range&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	{
+		const size_t Count = 100000;
+		double sum1 = 0, sum2 = 0;
+		auto strMcs = measureMcs([&]() {
+			for (size_t i = 0; i < Count; ++i) {
+				sum1 += json.as<double>("features.[42].geometry.coordinates.[0].[3].[1]");
+			}
+		}, 3);
+		auto pathMcs = measureMcs([&]() {
+			for (size_t i = 0; i < Count; ++i) {
+				sum2 += json.as<double>(path);
+			}
+		}, 3);
+		assert(sum1 == sum2);
+		cout << format("{} lookups: string path {}mcs, compiled path {}mcs\n", Count, strMcs, pathMcs);
+	}
+}
+
+void testJsonFind() {
+	cout << format("{:-^40}\n", "Testing json find");
+	Json json = JsonDecoder().decode("{\"a\":{\"b\":[1,{\"c\":\"x\"}]},\"n\":null}");
+	const ObjNode& obj = std::get<ObjNode>(json.get());
+	// transparent lookups - no Str is made
+	std::string key = "a";
+	assert(obj.ccont().find(std::string_view(key)) != obj.ccont().end());
+	assert(obj.ccont().find(key) != obj.ccont().end() && obj.ccont().contains("n") && !obj.ccont().contains("c"));
+	assert(obj.find("a") == &json.get("a") && obj.find("x") == nullptr);
+	assert(json.find("a.b.[1].c") == &json.get("a.b.[1].c"));
+	assert(json.find(std::vector<std::string_view>{ "a", "b", "[0]" }) == &json.get("a.b.[0]"));
+	assert(json.find(JsonPath("a.b.[1]")) == &json.get("a.b.[1]"));
+	for (auto path : { "x", "a.x", "a.b.[2]", "a.b.[x]", "a.b.[0].c", "n.c" }) {
+		assert(json.find(path) == nullptr && json.find(JsonPath(path)) == nullptr);
+	}
+	{
+		// optional field, which is mostly absent
+		const size_t Count = 100000;
+		size_t found1 = 0, found2 = 0;
+		auto throwMcs = measureMcs([&]() {
+			for (size_t i = 0; i < Count; ++i) {
+				try {
+					json.get("a.b.[1].d");
+					++found1;
+				}
+				catch (const std::out_of_range&) {
+				}
+			}
+		}, 3);
+		auto findMcs = measureMcs([&]() {
+			for (size_t i = 0; i < Count; ++i) {
+				found2 += json.find("a.b.[1].d") != nullptr;
+			}
+		}, 3);
+		assert(found1 == 0 && found2 == 0);
+		cout << format("{} missing keys: get {}mcs, find {}mcs\n", Count, throwMcs, findMcs);
+	}
+}
+
+void testJsonObjMap() {
+	cout << format("{:-^40}\n", "Testing json object order");
+	// keys are encoded in order of decoding, duplicate key replaces value in place
+	std::string si = "{\"z\":1,\"a\":{\"y\":[],\"b\":null},\"m\":\"s\",\"z\":2}";
+	assert(JsonEncoder().encode(JsonDecoder().decode(si)) == "{\"z\":2,\"a\":{\"y\":[],\"b\":null},\"m\":\"s\"}");
+	assert(JsonEncoder().encode(Json(ObjNode({ { "b", 1 }, { "a", 2 } }))) == "{\"b\":1,\"a\":2}");
+	// linear search for small objects, hash index for large ones
+	for (size_t count : { ObjMap::IndexThreshold, ObjMap::IndexThreshold + 1, size_t(1000) }) {
+		ObjNode obj;
+		for (size_t i = 0; i < count; ++i) {
+			auto [it, inserted] = obj.cont().insert_or_assign(Str(format("key{}", i)), ValNode((int64_t)i));
+			assert(inserted);
+		}
+		assert(!obj.cont().insert_or_assign(Str("key0"), ValNode((int64_t)-1)).second && obj.ccont().size() == count);
+		assert(!obj.cont().emplace(Str("key1"), ValNode((int64_t)-1)).second);
+		for (size_t i = 1; i < count; ++i) {
+			std::string key = format("key{}", i);
+			assert(std::get<ValNode>(obj.ccont().at(key)).as<int64_t>() == (int64_t)i);
+			assert(obj.ccont().find(PrehashedKey{ key, utils::hashKey(key) }) == obj.ccont().begin() + i);
+		}
+		assert(!obj.ccont().contains("key") && obj.find("nokey") == nullptr);
+		assert(obj.cont().erase("key3") == 1 && obj.cont().erase("key3") == 0);
+		assert(obj.ccont().begin()[3].first.view() == "key4" && obj.ccont().find("key4") == obj.ccont().begin() + 3);
+		obj.cont()["key3"] = ValNode(true);
+		assert(obj.keys().back() == "key3" && obj.ccont().size() == count);
+	}
+}
+
+void testJsonKeyPool() {
+	cout << format("{:-^40}\n", "Testing json key pool");
+	auto keyData = [](const Json& json, std::string_view key) {
+		const auto& cont = std::get<ObjNode>(json.get()).ccont();
+		return cont.find(key)->first.data();
+	};
+	{
+		auto pool = std::make_shared<JsonKeyPool>();
+		JsonDecoder d1({ .keys = pool }), d2({ .keys = pool });
+		Json j1 = d1.decode("{\"id\":1,\"name\":\"a\",\"n\\u0061me2\":2}");
+		JsonArena arena;
+		Json j2 = d2.decode("{\"name\":\"b\",\"id\":2}", arena);
+		// same key of different documents is the same memory
+		assert(keyData(j1, "id") == keyData(j2, "id") && keyData(j1, "name") == keyData(j2, "name"));
+		// escaped keys are not interned
+		assert(j1.as<int64_t>("name2") == 2 && pool->stats().keys == 2);
+		Json j3 = d1.decode("{\"id\":3}");
+		auto stats = pool->stats();
+		assert(stats.hits == 3 && stats.misses == 3 && stats.bytes == 6);
+		// documents keep pool alive, copies own their keys
+		pool.reset();
+		d1 = JsonDecoder();
+		d2 = JsonDecoder();
+		Json j4 = j1;
+		j1 = Json();
+		assert(j4.as<std::string>("name") == "a" && j2.as<int64_t>("id") == 2 && j3.as<int64_t>("id") == 3);
+	}
+	{
+		// keys which don't fit are copied
+		auto pool = std::make_shared<JsonKeyPool>(1, 4);
+		Json json = JsonDecoder({ .keys = pool }).decode("{\"longkey\":1,\"a\":2,\"b\":3}");
+		assert(json.as<int64_t>("longkey") == 1 && json.as<int64_t>("b") == 3 && pool->stats().keys == 1);
+		// invalid utf-8 is not interned
+		bool thrown = false;
+		try {
+			JsonDecoder({ .keys = pool }).decode("{\"\xff\":1}");
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown && pool->stats().keys == 1);
+	}
+	{
+		// records of the same schema decoded by several threads
+		std::string si;
+		for (size_t i = 0; i < 20000; ++i) {
+			si.append(format("{{\"_id\":{0},\"guid\":\"g{0}\",\"friends\":[{{\"id\":1,\"name\":\"f\"}}],\"isActive\":true}}\n", i));
+		}
+		auto pool = std::make_shared<JsonKeyPool>();
+		NdjsonDecoder::Opts opts{ .threads = 4, .batchSize = 16 * 1024 };
+		opts.decoder.keys = pool;
+		std::vector<Json> records;
+		auto internMcs = measureMcs([&]() {
+			records.clear();
+			NdjsonDecoder(opts).decode(si, [&](Json&& record) { records.push_back(std::move(record)); });
+		}, 1);
+		assert(records.size() == 20000 && records[123].as<std::string>("friends.[0].name") == "f");
+		auto stats = pool->stats();
+		assert(stats.keys == 6 && stats.hits + stats.misses == 20000 * 6);
+		records.clear();
+		opts.decoder.keys = nullptr;
+		auto copyMcs = measureMcs([&]() {
+			records.clear();
+			NdjsonDecoder(opts).decode(si, [&](Json&& record) { records.push_back(std::move(record)); });
+		}, 1);
+		cout << format("{} keys: hit rate {:.4f}, {} distinct keys ({} bytes); decode {}mcs (without pool {}mcs)\n",
+			stats.hits + stats.misses, stats.hitRate(), stats.keys, stats.bytes, internMcs, copyMcs);
+	}
+}
+
+void testJsonBinary() {
+	cout << format("{:-^40}\n", "Testing binary json formats");
+	auto bytes = [](std::initializer_list<uint8_t> b) { return std::string(b.begin(), b.end()); };
+	Json small = JsonDecoder().decode("{\"a\":1,\"b\":[2,3]}");
+	assert(CborEncoder().encode(small) == bytes({ 0xa2, 0x61, 'a', 0x01, 0x61, 'b', 0x82, 0x02, 0x03 }));
+	assert(MsgpackEncoder().encode(small) == bytes({ 0x82, 0xa1, 'a', 0x01, 0xa1, 'b', 0x92, 0x02, 0x03 }));
+	// examples of RFC 8949: half float, uint64 beyond int64, tag, indefinite lengths
+	assert(CborDecoder().decode(bytes({ 0xf9, 0x3c, 0x00 })).as<double>() == 1.0);
+	assert(CborDecoder().decode(bytes({ 0x1b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff })).as<double>() == 18446744073709551615.0);
+	assert(CborDecoder().decode(bytes({ 0xc1, 0x1a, 0x51, 0x4b, 0x67, 0xb0 })).as<int64_t>() == 1363896240);
+	assert(JsonEncoder().encode(CborDecoder().decode(bytes({ 0xbf, 0x61, 'a', 0x9f, 0x01, 0xff, 0x61, 'b', 0x7f, 0x61, 'c', 0x62, 'd', 'e', 0xff, 0xff })))
+		== "{\"a\":[1],\"b\":\"cde\"}");
+	assert(MsgpackDecoder().decode(bytes({ 0xd0, 0x80 })).as<int64_t>() == -128);
+	assert(MsgpackDecoder().decode(bytes({ 0xcf, 0x80, 0, 0, 0, 0, 0, 0, 0 })).as<double>() == 9223372036854775808.0);
+	// text, CBOR and MessagePack give the same tree
+	std::string text = "{\"int\":[0,-1,23,24,-24,-25,127,128,-32,-33,255,256,65535,65536,-129,-32769,4294967296,-2147483649,"
+		"9223372036854775807,-9223372036854775808],\"float\":[0.5,-1e300,3.141592653589793],\"str\":[\"\",\"a\\\\b\\\"c\",\"\u043a\u043e\u0442\","
+		"\"" + std::string(40, 'x') + "\",\"" + std::string(300, 'y') + "\",\"" + std::string(70000, 'z') + "\"],\"other\":[true,false,null,{},[]]}";
+	Json json = JsonDecoder().decode(text);
+	Json geo = JsonDecoder().decode(makeGeoJson(2000, 50));
+	auto roundTrip = [&]<typename Encoder, typename Decoder>(const Json& doc) {
+		std::string bin = Encoder().encode(doc);
+		std::string expected = JsonEncoder().encode(doc);
+		assert(JsonEncoder().encode(Decoder().decode(bin)) == expected);
+		JsonArena arena;
+		assert(JsonEncoder().encode(Decoder().decode(bin, arena)) == expected);
+		auto source = std::make_shared<std::string>(bin);
+		assert(JsonEncoder().encode(Decoder().decode(*source, source)) == expected);
+		// chunked output
+		CountingJsonWriter writer;
+		Encoder({ .chunkSize = 4096 }).encode(doc, writer);
+		assert(writer.out == bin);
+		// truncated and extended documents
+		for (size_t size : { size_t(1), bin.size() / 2, bin.size() - 1 }) {
+			bool thrown = false;
+			try {
+				Decoder().decode(std::string_view(bin).substr(0, size));
+			}
+			catch (const std::runtime_error&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+		bool thrown = false;
+		try {
+			Decoder().decode(bin + bin);
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown);
+		return bin;
+	};
+	roundTrip.operator()<CborEncoder, CborDecoder>(json);
+	roundTrip.operator()<MsgpackEncoder, MsgpackDecoder>(json);
+	std::string geoCbor = roundTrip.operator()<CborEncoder, CborDecoder>(geo);
+	std::string geoMsgpack = roundTrip.operator()<MsgpackEncoder, MsgpackDecoder>(geo);
+	// streaming - documents follow each other and arrive in pieces
+	{
+		std::string stream;
+		for (int64_t i = 0; i < 100; ++i) {
+			stream += CborEncoder().encode(Json(ObjNode({ { "id", i }, { "name", ValNode(format("name {}", i)) } })));
+		}
+		CborDecoder decoder;
+		std::string received;
+		int64_t next = 0;
+		for (size_t pos = 0; pos < stream.size(); pos += 7) {
+			received.append(stream.substr(pos, 7));
+			Json doc;
+			while (size_t size = decoder.decodeNext(received, doc)) {
+				assert(doc.as<int64_t>("id") == next && doc.as<std::string>("name") == format("name {}", next));
+				++next;
+				received.erase(0, size);
+			}
+		}
+		assert(next == 100 && received.empty());
+	}
+	// invalid data
+	for (std::string bin : { bytes({ 0x41, 'a' }), bytes({ 0xa1, 0x01, 0x02 }), bytes({ 0x61, 0xff }), bytes({ 0xff }), bytes({ 0x1c }),
+		std::string(2000, '\x81') + bytes({ 0x01 }) }) {
+		bool thrown = false;
+		try {
+			CborDecoder().decode(bin);
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	for (std::string bin : { bytes({ 0xc4, 0x01, 'a' }), bytes({ 0x81, 0x01, 0x02 }), bytes({ 0xa1, 0xc1 }), bytes({ 0xc1 }) }) {
+		bool thrown = false;
+		try {
+			MsgpackDecoder().decode(bin);
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	{
+		std::string geoText = JsonEncoder().encode(geo);
+		std::string out;
+		auto textEncodeMcs = measureMcs([&]() { out.clear(); JsonEncoder().encode(geo, out); }, 5);
+		auto cborEncodeMcs = measureMcs([&]() { out.clear(); CborEncoder().encode(geo, out); }, 5);
+		auto msgpackEncodeMcs = measureMcs([&]() { out.clear(); MsgpackEncoder().encode(geo, out); }, 5);
+		auto textDecodeMcs = measureMcs([&]() { JsonDecoder().decode(geoText); }, 5);
+		auto cborDecodeMcs = measureMcs([&]() { CborDecoder().decode(geoCbor); }, 5);
+		auto msgpackDecodeMcs = measureMcs([&]() { MsgpackDecoder().decode(geoMsgpack); }, 5);
+		cout << format("text: {} bytes, encode {}mcs, decode {}mcs\n", geoText.size(), textEncodeMcs, textDecodeMcs);
+		cout << format("cbor: {} bytes, encode {}mcs, decode {}mcs\n", geoCbor.size(), cborEncodeMcs, cborDecodeMcs);
+		cout << format("msgpack: {} bytes, encode {}mcs, decode {}mcs\n", geoMsgpack.size(), msgpackEncodeMcs, msgpackDecodeMcs);
+	}
+}
+
+void testJsonImage() {
+	cout << format("{:-^40}\n", "Testing json images");
+	std::string text = "{\"z\":[0,-1,36028797018963967,-36028797018963968,36028797018963968,-9223372036854775808,0.25],"
+		"\"a\":{\"s\":\"str\",\"e\":\"\",\"t\":true,\"f\":false,\"n\":null,\"o\":{},\"arr\":[]},\"m\":\"str\"}";
+	Json json = JsonDecoder().decode(text);
+	std::string bytes = JsonImage::serialize(json);
+	JsonImage image = JsonImage::fromMemory(bytes);
+	assert(image.type() == NodeType::Object && image.keys() == std::vector<std::string>({ "z", "a", "m" }));
+	assert(image.keys("a") == std::vector<std::string>({ "s", "e", "t", "f", "n", "o", "arr" }));
+	for (size_t i = 0; i < 6; ++i) {
+		std::string path = format("z.[{}]", i);
+		assert(image.as<int64_t>(path) == json.as<int64_t>(path));
+	}
+	assert(image.as<double>("z.[6]") == 0.25 && image.arrSize("z") == 7 && image.arrSize("a.arr") == 0);
+	assert(image.as<std::string_view>("a.s") == "str" && image.as<std::string>("a.e").empty());
+	assert(image.as<bool>("a.t") && !image.as<bool>("a.f") && image.get("a.n").type() == NodeType::Null);
+	assert(image.get("a.o").keys().empty());
+	// equal strings are stored once
+	assert(image.as<std::string_view>("a.s").data() == image.as<std::string_view>("m").data());
+	for (auto bad : { "x", "a.x", "z.[7]", "z.[x]", "m.x" }) {
+		bool thrown = false;
+		try {
+			image.get(bad);
+		}
+		catch (const std::out_of_range&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	bool thrown = false;
+	try {
+		image.as<int64_t>("a.s");
+	}
+	catch (const std::bad_variant_access&) {
+		thrown = true;
+	}
+	assert(thrown);
+	// damaged images are detected
+	for (std::string damaged : { bytes.substr(0, bytes.size() - 8), "JSONIMG0" + bytes.substr(8), bytes.substr(0, 16) }) {
+		thrown = false;
+		try {
+			JsonImage::fromMemory(damaged);
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	{
+		// all lookups of a large document give the same values as decoded tree
+		Json geo = JsonDecoder().decode(makeGeoJson(20000, 20));
+		std::string geoText = JsonEncoder().encode(geo);
+		std::string path = "f:/doc.img";
+		JsonImage::write(geo, path);
+		JsonImage geoImage(path);
+		for (size_t i = 0; i < 20000; i += 997) {
+			std::string p = format("features.[{}].geometry.coordinates.[0].[{}].[1]", i, i % 20);
+			assert(geoImage.as<double>(p) == geo.as<double>(p));
+			assert(geoImage.as<int64_t>(JsonPath(format("features.[{}].properties.id", i))) == (int64_t)i);
+		}
+		assert(geoImage.keys("features.[5]") == geo.keys("features.[5]"));
+		auto decodeMcs = measureMcs([&]() { JsonDecoder().decode(geoText); }, 1);
+		auto loadMcs = measureMcs([&]() { JsonImage(path).as<int64_t>("features.[19999].properties.id"); }, 3);
+		JsonPath compiled("features.[12345].geometry.coordinates.[0].[7].[0]");
+		double expected = geo.as<double>(compiled);
+		size_t found = 0;
+		auto lookupMcs = measureMcs([&]() {
+			for (size_t i = 0; i < 100000; ++i) {
+				found += geoImage.as<double>(compiled) == expected;
+			}
+		}, 1);
+		assert(found == 100000);
+		cout << format("{} bytes of text, {} bytes of image: decode {}mcs, load {}mcs, 100000 lookups {}mcs\n",
+			geoText.size(), geoImage.bytes().size(), decodeMcs, loadMcs, lookupMcs);
+		std::remove(path.c_str());
+	}
+}
+
+void testJsonParallel() {
+	cout << format("{:-^40}\n", "Testing parallel decoding");
+	// strings and nested arrays have ",{" inside, so some guessed boundaries are wrong
+	std::string arr = "[";
+	for (size_t i = 0; i < 5000; ++i) {
+		arr.append(i ? ",\n" : "").append(format("{{\"id\":{0},\"text\":\"a,{{\\\"id\\\":{0}}}\",\"items\":[{{\"n\":1}},{{\"n\":{0}}}]}}", i));
+	}
+	arr.append("]");
+	// duplicate keys: value of the last one at place of the first one
+	std::string obj = "{";
+	for (size_t i = 0; i < 20000; ++i) {
+		obj.append(i ? "," : "").append(format("\"k{}\":[{},\"s,\\\"k\\\":\"]", i % 3000, i));
+	}
+	obj.append("}");
+	JsonEncoder je1;
+	for (const std::string& si : { arr, obj, makeGeoJson(2000, 10), makeJsonDoc(10000, 2) }) {
+		std::string expected = je1.encode(JsonDecoder().decode(si));
+		for (size_t threads : { 2, 3, 8 }) {
+			JsonDecoder jd1({ .threads = threads, .parallelMinSize = 0 });
+			assert(je1.encode(jd1.decode(si)) == expected);
+			assert(je1.encode(jd1.decode(si, std::make_shared<std::string>())) == expected);
+		}
+	}
+	{
+		auto keys = std::make_shared<JsonKeyPool>();
+		Json j1 = JsonDecoder({ .keys = keys, .threads = 4, .parallelMinSize = 0 }).decode(arr);
+		assert(j1.as<int64_t>("[4999].items.[1].n") == 4999 && keys->stats().hits > 0);
+	}
+	// errors are found in any part, not only in the first one
+	std::string invalid = arr;
+	invalid.insert(arr.find(",\n", arr.size() / 2) + 2, "x");
+	for (std::string si : { arr.substr(0, arr.size() - 1), arr + ",", invalid,
+		arr.substr(0, arr.size() - 1) + ",]", "[1 " + arr.substr(1) }) {
+		bool thrown = false;
+		try {
+			JsonDecoder({ .threads = 4, .parallelMinSize = 0 }).decode(si);
+		}
+		catch (const std::exception&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	{
+		std::string si = makeJsonDoc(100000, 1);
+		Json expected = JsonDecoder().decode(si);
+		for (size_t threads : { 1, 2, 4, 8, 16, 32 }) {
+			JsonDecoder jd1({ .threads = threads });
+			Json j1;
+			auto mcs = measureMcs([&]() { j1 = jd1.decode(si); }, 1);
+			assert(j1.arrSize(std::vector<std::string>{}) == 100000 && j1.as<std::string>("[99999].child.name") == "item 99999");
+			cout << format("{} bytes, {} threads: {}mcs\n", si.size(), threads, mcs);
+		}
+	}
+}
+
+void testJsonParallelEncode() {
+	cout << format("{:-^40}\n", "Testing parallel encoding");
+	Json j1 = JsonDecoder().decode(makeJsonDoc(20000, 1));
+	// nested arrays are encoded in parallel too, with their indentation
+	Json j2 = JsonDecoder().decode("{\"rows\":" + makeJsonDoc(3000, 2) + ",\"empty\":[],\"small\":[[1,2],[3]]}");
+	for (bool hr : { false, true }) {
+		for (const Json* j : { &j1, &j2 }) {
+			std::string expected = JsonEncoder({ .humanReadable = hr }).encode(*j);
+			for (size_t threads : { 2, 3, 8 }) {
+				JsonEncoder je1({ .humanReadable = hr, .chunkSize = 4096, .threads = threads, .parallelMinSize = 100 });
+				assert(je1.encode(*j) == expected);
+				CountingJsonWriter w1;
+				je1.encode(*j, w1);
+				assert(w1.out == expected);
+			}
+		}
+	}
+	JsonEncoder je1({ .threads = 4, .parallelMinSize = 100 });
+	std::string expected = je1.encode(j1);
+	{
+		// buffers of threads are written by writev()
+		std::string path = "f:/enc.json";
+		FILE* f = fopen(path.c_str(), "wb");
+		FdJsonWriter w1(fileno(f));
+		je1.encode(j1, w1);
+		fclose(f);
+		std::stringstream ss;
+		ss << std::ifstream(path).rdbuf();
+		assert(ss.str() == expected);
+		std::remove(path.c_str());
+	}
+	{
+		std::deque<inet::OutputSocketBuffer> chain;
+		SocketBufferJsonWriter w1(chain);
+		je1.encode(j1, w1);
+		std::string res;
+		for (auto& segment : chain) {
+			segment.write([&res](int, const char* data, size_t n) { res.append(data, n); return (ssize_t)n; }, 0);
+		}
+		assert(res == expected);
+	}
+	{
+		// invalid utf-8 in one of ranges
+		Json j3 = JsonDecoder().decode(makeJsonDoc(10000, 0));
+		j3.get("[7777].name") = ValNode(std::string("\xC0\x80"));
+		bool thrown = false;
+		try {
+			je1.encode(j3);
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		assert(thrown);
+	}
+	{
+		Json big = JsonDecoder().decode(makeJsonDoc(100000, 1));
+		for (size_t threads : { 1, 2, 4, 8 }) {
+			JsonEncoder je2({ .threads = threads });
+			std::string out;
+			auto mcs = measureMcs([&]() {
+				out.clear();
+				je2.encode(big, out);
+			}, 3);
+			cout << format("{} bytes, {} threads: {}mcs\n", out.size(), threads, mcs);
+		}
+	}
+}
+
+void testJsonCow() {
+	cout << format("{:-^40}\n", "Testing copy-on-write");
+	auto containerOf = [](const Json& json, const std::string& key) {
+		const Node& node = key.empty() ? json.get() : json.get(key);
+		return std::holds_alternative<ArrNode>(node) ? (const void*)&std::get<ArrNode>(node).ccont() : (const void*)&std::get<ObjNode>(node).ccont();
+	};
+	std::string si = makeJsonDoc(10000, 2);
+	const Json cached = JsonDecoder().decode(si);
+	JsonEncoder je1;
+	std::string expected = je1.encode(cached);
+	{
+		// copy shares tree
+		Json j1 = cached;
+		assert(containerOf(j1, "") == containerOf(cached, "") && std::get<ArrNode>(cached.get()).shared());
+		// only path to modified node is copied
+		j1.get("[5].child.child.name") = ValNode(std::string("changed"));
+		assert(j1.as<std::string>("[5].child.child.name") == "changed" && cached.as<std::string>("[5].child.child.name") == "item 5");
+		for (auto key : { "", "[5]", "[5].child", "[5].child.child" }) {
+			assert(containerOf(j1, key) != containerOf(cached, key));
+		}
+		for (auto key : { "[4]", "[6]", "[5].tags", "[5].child.tags" }) {
+			assert(containerOf(j1, key) == containerOf(cached, key));
+		}
+		// the rest is unchanged
+		j1.get("[5].child.child.name") = ValNode(std::string("item 5"));
+		assert(je1.encode(j1) == expected);
+		// modification through cont() of node copy
+		Node node = cached.get("[7].tags");
+		std::get<ArrNode>(node).cont().push_back(ValNode(4));
+		assert(std::get<ArrNode>(node).size() == 4 && cached.arrSize("[7].tags") == 3);
+		// paths to missing nodes
+		assert(!j1.find("[5].child.nope") && !j1.find(JsonPath("[10000]")));
+		j1.get(JsonPath("[9].child.lvl")) = ValNode(100);
+		assert(j1.as<int64_t>("[9].child.lvl") == 100 && cached.as<int64_t>("[9].child.lvl") == 0);
+		assert(je1.encode(cached) == expected);
+	}
+	{
+		// nodes borrowing parsed text aren't shared: copies outlive it
+		auto text = std::make_shared<std::string>(si);
+		Json j1 = JsonDecoder().decode(*text, text);
+		Json j2 = j1;
+		Node node = j1.get("[3]");
+		assert(containerOf(j1, "[3]") != containerOf(j2, "[3]"));
+		j1 = Json();
+		text.reset();
+		assert(je1.encode(j2) == expected && std::get<ObjNode>(node).ccont().find("lvl")->first == "lvl");
+	}
+	{
+		// near-identical responses from cached template
+		std::vector<Json> responses;
+		responses.reserve(1000);
+		auto cowMcs = measureMcs([&]() {
+			for (size_t i = 0; i < 1000; ++i) {
+				Json& res = responses.emplace_back(cached);
+				res.get(format("[{}].child.child.id", i)) = ValNode(-(int64_t)i);
+			}
+		}, 1);
+		for (size_t i = 0; i < 1000; i += 99) {
+			assert(responses[i].as<int64_t>(format("[{}].child.child.id", i)) == -(int64_t)i);
+			assert(responses[i].as<int64_t>(format("[{}].child.child.id", i + 1)) == (int64_t)i + 1);
+		}
+		// same responses made by decoding
+		auto deepMcs = measureMcs([&]() {
+			for (size_t i = 0; i < 10; ++i) {
+				Json res(JsonDecoder().decode(si));
+				res.get(format("[{}].child.child.id", i)) = ValNode(-(int64_t)i);
+			}
+		}, 1) * 100;
+		cout << format("{} bytes, 1000 modified copies: copy-on-write {}mcs, deep copies ~{}mcs\n", si.size(), cowMcs, deepMcs);
+	}
+	assert(je1.encode(cached) == expected);
+}
+
 void test::testJsonMain() {
 	cout << "----------------------TESTING JSON-----------------------\n";
 	/*
@@ -240,6 +2002,31 @@ void test::testJsonMain() {
 	std::cout << std::format("Size of '3' is: {}\n", json.arrSize("3"));
 
 	testJsonDecode();
+	testJsonDecodeBench();
+	testJsonSimd();
+	testJsonView();
+	testJsonArena();
+	testJsonBorrowed();
+	testJsonTape();
+	testJsonStream();
+	testJsonSax();
+	testJsonNdjson();
+	testJsonFile();
+	testJsonDecodeNumbers();
+	testJsonEncodeNumbers();
+	testJsonEncodeEscape();
+	testJsonUnescape();
+	testJsonWriter();
+	testJsonReflect();
+	testJsonPath();
+	testJsonFind();
+	testJsonObjMap();
+	testJsonKeyPool();
+	testJsonBinary();
+	testJsonImage();
+	testJsonParallel();
+	testJsonParallelEncode();
+	testJsonCow();
 
 	Json json1 = json;
 	json1.get() = ValNode((int64_t)10);
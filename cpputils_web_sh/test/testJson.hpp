@@ -3,7 +3,24 @@
 #include <format>
 #include <chrono>
 #include <fstream>
+#include <sstream>
+#include <random>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <charconv>
 #include "../Json.hpp"
+#include "../JsonSimd.hpp"
+#include "../JsonView.hpp"
+#include "../JsonTape.hpp"
+#include "../JsonStream.hpp"
+#include "../JsonSax.hpp"
+#include "../JsonNdjson.hpp"
+#include "../JsonWriter.hpp"
+#include "../Socket.hpp"
+#include "../JsonReflect.hpp"
+#include "../JsonBinary.hpp"
+#include "../JsonImage.hpp"
 
 namespace util::web::json::test {
 	void testJsonMain();